@@ -0,0 +1,167 @@
+#include <batch_renderer.h>
+#include <ephemeris.h>
+#include <headless_context.h>
+#include <image_writer.h>
+#include <solar_system.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+// images waiting for a writer per render worker before the workers are held back
+static const size_t QUEUED_IMAGES_PER_WORKER = 4;
+
+bool parse_batch_range(const std::string &spec, std::vector<SimTick> &ticks) {
+    double first, last, step_hours;
+    char tail;
+    if (std::sscanf(spec.c_str(), "%lf:%lf:%lf%c", &first, &last, &step_hours, &tail) != 3 || !(step_hours > 0.0)
+        || !(last >= first)) {
+        std::cout << "ERROR::BATCH::BAD_RANGE: " << spec << ", expected <first day>:<last day>:<step hours>"
+                  << std::endl;
+        return false;
+    }
+    // steps are counted from the first day, so rounding does not accumulate over long ranges
+    const SimTick first_tick = sim_ticks_from_days(first), last_tick = sim_ticks_from_days(last);
+    const SimTick step = std::max<SimTick>((SimTick) std::llround(step_hours * (double) SIM_TICKS_PER_HOUR), 1);
+    for (SimTick tick = first_tick; tick <= last_tick; tick += step)
+        ticks.push_back(tick);
+    return true;
+}
+
+bool load_batch_times(const std::string &path, std::vector<SimTick> &ticks) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cout << "ERROR::BATCH::TIME_LIST_NOT_READ: " << path << std::endl;
+        return false;
+    }
+    double day;
+    while (file >> day)
+        ticks.push_back(sim_ticks_from_days(day));
+    if (!file.eof()) {
+        std::cout << "ERROR::BATCH::BAD_TIME_LIST: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+struct BatchShared {
+    const BatchSettings &settings;
+    const EphemerisTable *ephemeris;
+    ImageWriter &writer;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> frames_done{0};  // handed to the writer
+    std::atomic<bool> failed{false};
+};
+
+static std::string frame_path(const BatchSettings &settings, size_t index) {
+    char number[32];
+    std::snprintf(number, sizeof(number), "_%06zu.", index);
+    return settings.output_prefix + number + settings.format;
+}
+
+// one worker: a context, a renderer and a scene of its own, taking the next unclaimed tick each time
+static void batch_worker(BatchShared &shared) {
+    const BatchSettings &settings = shared.settings;
+    HeadlessContext context;
+    if (!settings.software && !context.create(settings.width, settings.height)) {
+        shared.failed = true;
+        return;
+    }
+    SceneRenderer renderer;
+    renderer.set_shader_cache(settings.shader_cache);
+    if (!renderer.init(settings.software, settings.width, settings.height, 1)) {
+        shared.failed = true;
+        return;
+    }
+    renderer.set_camera(settings.camera);
+    ScreenCapture capture;
+
+    BodyRegistry bodies;
+    NBodySystem nbody;
+    int32_t focus = settings.nbody_count > 0 ? build_nbody_system(bodies, nbody, settings.nbody_count)
+                                             : build_solar_system(bodies);
+    SpkKernel spk;
+    bool use_spk = settings.nbody_count == 0 && !settings.spk_path.empty() && spk.open(settings.spk_path);
+    std::vector<float> x(bodies.size()), y(bodies.size()), z(bodies.size());
+
+    size_t index;
+    while (!shared.failed && (index = shared.next.fetch_add(1)) < settings.ticks.size()) {
+        SimTick tick = settings.ticks[index];
+        if (use_spk && spk_solar_system_positions(spk, tick, x.data(), y.data(), z.data())) {
+            bodies.seek(tick, x.data(), y.data(), z.data());
+        } else if (shared.ephemeris != NULL) {
+            shared.ephemeris->evaluate(tick, x.data(), y.data(), z.data());
+            bodies.seek(tick, x.data(), y.data(), z.data());
+        } else {
+            bodies.seek(tick);
+        }
+        renderer.draw(bodies, focus);
+
+        std::string path = frame_path(settings, index);
+        auto write_frame = [&shared, path](const uint8_t *pixels, uint32_t width, uint32_t height) {
+            shared.writer.submit(path, pixels, width, height, 4, true);
+            shared.frames_done++;
+        };
+        renderer.capture(capture, write_frame, true);
+        capture.poll();
+    }
+    capture.release();
+    renderer.release();
+}
+
+bool render_batch(const BatchSettings &settings, BatchReport &report) {
+    report = BatchReport();
+    if (settings.ticks.empty()) {
+        std::cout << "ERROR::BATCH::NO_TIMES" << std::endl;
+        return false;
+    }
+
+    // the table is only read, so every worker shares one
+    EphemerisTable ephemeris;
+    bool use_ephemeris = false;
+    if (!settings.ephemeris_path.empty() && ephemeris.load(settings.ephemeris_path)) {
+        BodyRegistry probe;
+        NBodySystem nbody;
+        if (settings.nbody_count > 0)
+            build_nbody_system(probe, nbody, settings.nbody_count);
+        else
+            build_solar_system(probe);
+        use_ephemeris = ephemeris.body_count() == probe.size();
+        if (!use_ephemeris)
+            std::cout << "Ephemeris has " << ephemeris.body_count() << " bodies, scene has " << probe.size()
+                      << ", ignoring it" << std::endl;
+    }
+    if (settings.nbody_count > 0 && !use_ephemeris) {
+        std::cout << "ERROR::BATCH::NBODY_NOT_SEEKABLE: n-body positions need an ephemeris table from ephemeris_gen"
+                  << std::endl;
+        return false;
+    }
+
+    size_t workers = settings.workers > 0 ? settings.workers : std::max(1u, std::thread::hardware_concurrency());
+    workers = std::min(workers, settings.ticks.size());
+    // one writer per render worker keeps encoding from becoming the bottleneck; PNG strips of
+    // a single image are not split further
+    ImageWriter writer(1, workers, workers * QUEUED_IMAGES_PER_WORKER);
+    BatchShared shared{settings, use_ephemeris ? &ephemeris : NULL, writer};
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < workers; i++)
+        threads.emplace_back(batch_worker, std::ref(shared));
+    for (std::thread &thread: threads)
+        thread.join();
+    writer.flush();
+    auto end = std::chrono::steady_clock::now();
+
+    report.frames = shared.frames_done;
+    report.workers = workers;
+    report.seconds = std::chrono::duration<double>(end - start).count();
+    report.frames_per_second = report.seconds > 0.0 ? (double) report.frames / report.seconds : 0.0;
+    return !shared.failed;
+}
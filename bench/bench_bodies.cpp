@@ -0,0 +1,46 @@
+#include <body_registry.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// times BodyRegistry::update for the sun/earth/moon system plus a field of extra moons and asteroids
+int main(int argc, char **argv) {
+    size_t extra_bodies = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    BodyRegistry bodies;
+    bodies.reserve(extra_bodies + 3);
+    int32_t sun = bodies.add_body({-1, 0.0f, 0.0f, 27.0f, 0.0f, 6.0f});
+    int32_t earth = bodies.add_body({sun, 24.0f, 365.0f, 1.0f, 23.4f, 3.0f});
+    bodies.add_body({earth, 12.0f, 28.0f, 28.0f, 0.0f, 1.5f});
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < extra_bodies; i++) {
+        // every tenth body is a moon of the previous asteroid, the rest orbit the sun
+        int32_t parent = (i % 10 == 9) ? (int32_t) bodies.size() - 1 : sun;
+        float radius = parent == sun ? 30.0f + 200.0f * unit(rng) : 0.5f + unit(rng);
+        bodies.add_body({parent, radius, 10.0f + 1000.0f * unit(rng), 0.1f + 10.0f * unit(rng),
+                         45.0f * unit(rng), 0.05f + 0.2f * unit(rng)});
+    }
+
+    // warm up caches and page in the output array
+    bodies.seek(0);
+
+    auto start = std::chrono::steady_clock::now();
+    SimClock clock;
+    for (int i = 0; i < iterations; i++) {
+        clock.advance(SIM_TICKS_PER_HOUR);
+        bodies.seek(clock.tick());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    double ns_per_body = ns / ((double) iterations * (double) bodies.size());
+    std::cout << "bodies: " << bodies.size() << ", iterations: " << iterations
+              << ", update: " << ns / iterations / 1.0e6 << " ms, " << ns_per_body << " ns/body" << std::endl;
+    std::cout << "checksum: " << bodies.world_matrices()[bodies.size() - 1][3][0] << std::endl;
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <image_encoder.h>
+#include <thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// a frame shaped like the renderer's output: flat background with flat colored cube faces,
+// read back bottom-up as RGBA
+static Image synthetic_frame(uint32_t width, uint32_t height, size_t cubes) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.channels = 4;
+    image.bottom_up = true;
+    image.pixels.resize((size_t) width * height * 4);
+    for (size_t i = 0; i < (size_t) width * height; i++) {
+        image.pixels[4 * i] = 76;
+        image.pixels[4 * i + 1] = 102;
+        image.pixels[4 * i + 2] = 127;
+        image.pixels[4 * i + 3] = 255;
+    }
+
+    const uint8_t faces[6][3] = {{255, 255, 0}, {255, 0, 255}, {0, 255, 0}, {255, 0, 0}, {0, 255, 255}, {0, 0, 255}};
+    std::mt19937 rng(42);
+    for (size_t k = 0; k < cubes; k++) {
+        uint32_t size = 4 + rng() % 60;
+        uint32_t x0 = rng() % width, y0 = rng() % height;
+        const uint8_t *color = faces[rng() % 6];
+        // a sheared quad, so edges are not all axis aligned
+        for (uint32_t y = y0; y < std::min(height, y0 + size); y++) {
+            uint32_t shift = (y - y0) / 2;
+            for (uint32_t x = x0 + shift; x < std::min(width, x0 + shift + size); x++) {
+                uint8_t *px = &image.pixels[4 * ((size_t) y * width + x)];
+                px[0] = color[0];
+                px[1] = color[1];
+                px[2] = color[2];
+            }
+        }
+    }
+    return image;
+}
+
+// encode throughput and size per format, counted against the raw RGB bytes
+int main(int argc, char **argv) {
+    uint32_t width = argc > 1 ? (uint32_t) std::strtoul(argv[1], NULL, 10) : 1024;
+    uint32_t height = argc > 2 ? (uint32_t) std::strtoul(argv[2], NULL, 10) : 768;
+    int iterations = argc > 3 ? std::atoi(argv[3]) : 30;
+
+    Image image = synthetic_frame(width, height, 300);
+    const double raw_mb = (double) width * height * 3 / (1024.0 * 1024.0);
+    ThreadPool pool;
+
+    struct Format {
+        const char *name;
+        ImageFormat format;
+        ThreadPool *pool;
+    } formats[] = {{"ppm", ImageFormat::PPM, NULL},
+                   {"qoi", ImageFormat::QOI, NULL},
+                   {"png, 1 thread", ImageFormat::PNG, NULL},
+                   {"png, pool", ImageFormat::PNG, &pool}};
+
+    std::cout << "frame: " << width << "x" << height << ", pool threads: " << pool.size() << std::endl;
+    std::vector<uint8_t> out;
+    for (const Format &f: formats) {
+        auto encode = [&] {
+            out.clear();
+            if (f.format == ImageFormat::PPM)
+                encode_ppm(image, out);
+            else if (f.format == ImageFormat::QOI)
+                encode_qoi(image, out);
+            else
+                encode_png(image, out, f.pool);
+        };
+        encode();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++)
+            encode();
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / iterations;
+        std::cout << f.name << ": " << ms << " ms/frame, " << raw_mb / (ms / 1000.0) << " MB/s, "
+                  << out.size() / 1024 << " KB (" << (double) width * height * 3 / (double) out.size()
+                  << "x smaller than raw)" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <kepler.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// times KeplerOrbits::propagate over a belt of eccentric, inclined asteroid orbits
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 20;
+
+    // sun-like central mass in scene units (24 units per year-long orbit, see main.cpp)
+    const double two_pi = 6.28318530717958647692;
+    const double radius = 24.0, period = 365.0;
+    KeplerOrbits orbits(two_pi * two_pi * radius * radius * radius / (period * period));
+    orbits.reserve(count);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; i++) {
+        OrbitalElements el;
+        el.a = 50.0f + 30.0f * unit(rng);
+        el.e = 0.3f * unit(rng);
+        el.i = 0.3f * unit(rng);
+        el.raan = 6.28f * unit(rng);
+        el.argp = 6.28f * unit(rng);
+        el.m0 = 6.28f * unit(rng);
+        orbits.add_orbit(el);
+    }
+
+    std::vector<float> x(count), y(count), z(count);
+    orbits.propagate(0, x.data(), y.data(), z.data());
+
+    auto start = std::chrono::steady_clock::now();
+    SimClock clock;
+    for (int i = 0; i < iterations; i++) {
+        clock.advance(SIM_TICKS_PER_HOUR);
+        orbits.propagate(clock.tick(), x.data(), y.data(), z.data());
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    std::cout << "orbits: " << count << ", iterations: " << iterations
+              << ", propagate: " << ns / iterations / 1.0e6 << " ms, "
+              << ns / ((double) iterations * (double) count) << " ns/body" << std::endl;
+    std::cout << "checksum: " << x[count - 1] << std::endl;
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include <nbody.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// times NBodySystem::step (tree build plus parallel force evaluation) for a sun and an asteroid disc
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 10;
+    size_t threads = argc > 3 ? std::strtoul(argv[3], NULL, 10) : 0;
+
+    NBodySystem nbody(threads);
+    nbody.reserve(count + 1);
+    const float sun_mu = 4.0f;
+    nbody.add_body(glm::vec3(0.0f), glm::vec3(0.0f), sun_mu);
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < count; i++) {
+        float radius = 30.0f + 60.0f * unit(rng);
+        float angle = 6.28318530717958647692f * unit(rng);
+        glm::vec3 pos(radius * std::cos(angle), 2.0f * unit(rng) - 1.0f, -radius * std::sin(angle));
+        glm::vec3 vel = std::sqrt(sun_mu / radius) * glm::vec3(pos.z, 0.0f, -pos.x) / radius;
+        nbody.add_body(pos, vel, sun_mu * 0.01f / (float) count);
+    }
+
+    // the first step also builds the initial tree
+    nbody.step(1.0f / 24.0f);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        nbody.step(1.0f / 24.0f);
+    auto end = std::chrono::steady_clock::now();
+
+    double ms = (double) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+    std::cout << "bodies: " << nbody.size() << ", iterations: " << iterations
+              << ", step: " << ms / iterations << " ms, "
+              << ms * 1.0e6 / ((double) iterations * (double) nbody.size()) << " ns/body, "
+              << "tree nodes: " << nbody.tree_node_count() << std::endl;
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <soft_rasterizer.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// one face of the scene's cube: two triangles, position and color per vertex
+static void add_face(std::vector<float> &out, const glm::vec3 &normal, const glm::vec3 &rgb) {
+    glm::vec3 u = glm::abs(normal.x) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0);
+    glm::vec3 w = glm::cross(normal, u);
+    const glm::vec3 corners[6] = {normal - u - w, normal + u - w, normal + u + w,
+                                  normal + u + w, normal - u + w, normal - u - w};
+    for (const glm::vec3 &p: corners)
+        out.insert(out.end(), {p.x, p.y, p.z, rgb.r, rgb.g, rgb.b});
+}
+
+// times frames of a field of spinning cubes seen the way main.cpp looks at the scene
+int main(int argc, char **argv) {
+    size_t cubes = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 5000;
+    uint32_t width = argc > 2 ? (uint32_t) std::strtoul(argv[2], NULL, 10) : 1920;
+    uint32_t height = argc > 3 ? (uint32_t) std::strtoul(argv[3], NULL, 10) : 1080;
+    int iterations = argc > 4 ? std::atoi(argv[4]) : 30;
+
+    std::vector<float> vertices;
+    add_face(vertices, {0, 0, -1}, {1, 1, 0});
+    add_face(vertices, {0, 0, 1}, {1, 0, 1});
+    add_face(vertices, {1, 0, 0}, {0, 1, 0});
+    add_face(vertices, {-1, 0, 0}, {1, 0, 0});
+    add_face(vertices, {0, -1, 0}, {0, 1, 1});
+    add_face(vertices, {0, 1, 0}, {0, 0, 1});
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3> positions(cubes), axes(cubes);
+    std::vector<float> scales(cubes);
+    for (size_t i = 0; i < cubes; i++) {
+        float radius = 20.0f + 60.0f * unit(rng), angle = 6.2831853f * unit(rng);
+        positions[i] = glm::vec3(radius * std::cos(angle), 4.0f * (unit(rng) - 0.5f), radius * std::sin(angle));
+        axes[i] = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + 0.1f);
+        scales[i] = 0.3f + 1.2f * unit(rng);
+    }
+    std::vector<glm::mat4> models(cubes);
+
+    glm::mat4 view = glm::lookAt(glm::vec3(100.0f, 50.0f, 100.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(30.0f), (float) width / (float) height, 0.1f, 1000.0f);
+
+    SoftRasterizer raster;
+    raster.resize(width, height);
+    std::cout << "cubes: " << cubes << ", frame: " << width << "x" << height << std::endl;
+
+    double total_ms = 0.0, worst_ms = 0.0;
+    for (int frame = -1; frame < iterations; frame++) {
+        for (size_t i = 0; i < cubes; i++) {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+            model = glm::rotate(model, 0.05f * (float) frame, axes[i]);
+            models[i] = glm::scale(model, glm::vec3(scales[i]));
+        }
+        auto start = std::chrono::steady_clock::now();
+        raster.clear(0.3f, 0.4f, 0.5f);
+        raster.draw_instanced(vertices.data(), vertices.size() / 6, view, projection, models.data(), cubes);
+        auto end = std::chrono::steady_clock::now();
+        // the first frame only warms up the buffers
+        if (frame < 0)
+            continue;
+        double ms = (double) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        total_ms += ms;
+        worst_ms = std::max(worst_ms, ms);
+    }
+
+    std::cout << "frame: " << total_ms / iterations << " ms (worst " << worst_ms << " ms), "
+              << 1000.0 * iterations / total_ms << " fps" << std::endl;
+    size_t background = 0;
+    for (size_t i = 0; i < (size_t) width * height; i++)
+        background += raster.pixels()[4 * i] == 77;
+    std::cout << "checksum: " << background << " background pixels" << std::endl;
+    return 0;
+}
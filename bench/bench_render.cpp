@@ -0,0 +1,89 @@
+#include <headless_context.h>
+#include <scene_renderer.h>
+#include <thread_pool.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+// GL frame time of the scene with a field of extra bodies, per instance transform path.
+// needs an EGL build.
+int main(int argc, char **argv) {
+    size_t extra_bodies = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 100000;
+    uint32_t width = argc > 2 ? (uint32_t) std::strtoul(argv[2], NULL, 10) : 1024;
+    uint32_t height = argc > 3 ? (uint32_t) std::strtoul(argv[3], NULL, 10) : 768;
+    int iterations = argc > 4 ? std::atoi(argv[4]) : 30;
+
+    HeadlessContext context;
+    if (!context.create(width, height))
+        return 1;
+
+    BodyRegistry bodies;
+    bodies.reserve(extra_bodies + 1);
+    int32_t sun = bodies.add_body({-1, 0.0f, 0.0f, 27.0f, 0.0f, 6.0f});
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (size_t i = 0; i < extra_bodies; i++)
+        bodies.add_body({sun, 20.0f + 60.0f * unit(rng), 10.0f + 1000.0f * unit(rng), 0.1f + 10.0f * unit(rng),
+                         45.0f * unit(rng), 0.05f + 0.3f * unit(rng)});
+
+    struct Path {
+        const char *name;
+        InstanceTransform transform;
+    } paths[] = {{"model, view-projection from the frame UBO", InstanceTransform::Model},
+                 {"model-view-projection from the CPU", InstanceTransform::ModelViewProjection}};
+
+    std::cout << "bodies: " << bodies.size() << ", frame: " << width << "x" << height << std::endl;
+    for (const Path &path: paths) {
+        SceneRenderer renderer;
+        // startup is dominated by building the program: compiled on the first run, from the
+        // shader cache after that
+        auto init_start = std::chrono::steady_clock::now();
+        renderer.init(false, width, height, 0, path.transform);
+        auto init_end = std::chrono::steady_clock::now();
+        std::cout << path.name << ": init " << std::chrono::duration<double, std::milli>(init_end - init_start).count()
+                  << " ms" << std::endl;
+        double total_ms = 0.0;
+        SimClock clock;
+        for (int frame = -1; frame < iterations; frame++) {
+            clock.advance(SIM_TICKS_PER_HOUR);
+            bodies.seek(clock.tick());
+            auto start = std::chrono::steady_clock::now();
+            renderer.draw(bodies, sun);
+            glFinish();
+            auto end = std::chrono::steady_clock::now();
+            // the first frame only warms up the driver
+            if (frame >= 0)
+                total_ms += (double) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        }
+        std::cout << path.name << ": " << total_ms / iterations << " ms/frame, GL state calls issued "
+                  << renderer.gl_frame_stats().issued << ", filtered " << renderer.gl_frame_stats().filtered
+                  << std::endl;
+        renderer.release();
+    }
+
+    // the CPU side of a frame alone, as the interactive loop records it while the render thread
+    // draws the previous one: serially, then chunks spread over a pool
+    SceneCamera camera;
+    FramePacket packet;
+    ThreadPool pool;
+    struct Recording {
+        const char *name;
+        ThreadPool *pool;
+    } recordings[] = {{"record on one thread", NULL}, {"record on the pool", &pool}};
+    for (const Recording &recording: recordings) {
+        double total_ms = 0.0;
+        for (int frame = -1; frame < iterations; frame++) {
+            auto start = std::chrono::steady_clock::now();
+            record_frame(bodies, sun, camera, (float) width / (float) height, InstanceTransform::ModelViewProjection,
+                         packet, recording.pool);
+            auto end = std::chrono::steady_clock::now();
+            if (frame >= 0)
+                total_ms += (double) std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        }
+        std::cout << recording.name << " (" << (recording.pool ? pool.size() + 1 : 1) << " threads): "
+                  << total_ms / iterations << " ms/frame, " << packet.commands.size() << " chunks" << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include <fast_trig.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtx/fast_trigonometry.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// absolute error in units of 2^-24, the float ULP just below 1; relative ULP is meaningless next to
+// the zeros of sine and cosine, where any error in the reduced argument dominates
+static double ulp_error(float value, double reference) {
+    return std::fabs((double) value - reference) * 16777216.0;
+}
+
+template<typename F>
+static double time_ns_per_angle(F &&kernel, size_t count, int iterations) {
+    kernel();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+        kernel();
+    auto end = std::chrono::steady_clock::now();
+    return (double) std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+           / ((double) iterations * (double) count);
+}
+
+// compares sincos_array tiers with std::sin/std::cos and glm's fastSin/fastCos, for speed over
+// [0, 2pi) and for the worst error over [-1000, 1000]
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1 << 20;
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> turn(0.0f, 6.28318530717958647692f);
+    std::uniform_real_distribution<float> wide(-1000.0f, 1000.0f);
+    std::vector<float> angles(count), wide_angles(count), s(count), c(count);
+    for (size_t i = 0; i < count; i++) {
+        angles[i] = turn(rng);
+        wide_angles[i] = wide(rng);
+    }
+
+    struct Tier {
+        const char *name;
+        TrigAccuracy accuracy;
+    } tiers[] = {{"fast", TrigAccuracy::Fast}, {"medium", TrigAccuracy::Medium}, {"exact", TrigAccuracy::Exact}};
+
+    std::cout << "angles: " << count << ", SIMD width: " << SIMD_FLOAT_WIDTH << std::endl;
+    for (const Tier &tier: tiers) {
+        double ns = time_ns_per_angle([&] {
+            sincos_array(angles.data(), s.data(), c.data(), count, tier.accuracy);
+        }, count, iterations);
+
+        sincos_array(wide_angles.data(), s.data(), c.data(), count, tier.accuracy);
+        double worst = 0.0;
+        for (size_t i = 0; i < count; i++) {
+            worst = std::max(worst, ulp_error(s[i], std::sin((double) wide_angles[i])));
+            worst = std::max(worst, ulp_error(c[i], std::cos((double) wide_angles[i])));
+        }
+        std::cout << "sincos_array " << tier.name << ": " << ns << " ns/angle, max error " << worst << " ULP(1)"
+                  << std::endl;
+    }
+
+    double std_ns = time_ns_per_angle([&] {
+        for (size_t i = 0; i < count; i++) {
+            s[i] = std::sin(angles[i]);
+            c[i] = std::cos(angles[i]);
+        }
+    }, count, iterations);
+    std::cout << "std::sin + std::cos: " << std_ns << " ns/angle" << std::endl;
+
+    // glm's versions are only meant for [-pi, pi] and [0, 2pi] respectively, so no error over the wide range
+    double glm_ns = time_ns_per_angle([&] {
+        for (size_t i = 0; i < count; i++) {
+            s[i] = glm::fastSin(angles[i] - 3.14159265358979323846f);
+            c[i] = glm::fastCos(angles[i]);
+        }
+    }, count, iterations);
+    double glm_worst = 0.0;
+    for (size_t i = 0; i < count; i++)
+        glm_worst = std::max(glm_worst, ulp_error(c[i], std::cos((double) angles[i])));
+    std::cout << "glm::fastSin + glm::fastCos: " << glm_ns << " ns/angle, max cos error over [0, 2pi) "
+              << glm_worst << " ULP(1)" << std::endl;
+    return 0;
+}
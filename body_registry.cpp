@@ -0,0 +1,135 @@
+#include <body_registry.h>
+
+#include <cmath>
+
+static const float TWO_PI = 6.28318530717958647692f;
+
+static double freq_from_period(float days) {
+    return days > 0.0f ? 1.0 / (double) days : 0.0;
+}
+
+int32_t BodyRegistry::add_body(const BodyDesc &desc) {
+    int32_t index = (int32_t) parent.size();
+    // a parent must already be registered, otherwise the update pass would read it before writing it
+    int32_t parent_index = desc.parent < index ? desc.parent : -1;
+    float tilt = glm::radians(-desc.tilt_degrees);
+
+    parent.push_back(parent_index);
+    orbit_radius.push_back(desc.orbit_radius);
+    orbit_freq.push_back(freq_from_period(desc.orbit_days));
+    spin_freq.push_back(freq_from_period(desc.revolve_days));
+    tilt_cos.push_back(std::cos(tilt));
+    tilt_sin.push_back(std::sin(tilt));
+    scale.push_back(desc.scale);
+
+    pos_x.push_back(0.0f);
+    pos_y.push_back(0.0f);
+    pos_z.push_back(0.0f);
+    world.emplace_back(1.0f);
+    evaluated = false;
+    return index;
+}
+
+void BodyRegistry::reserve(size_t count) {
+    parent.reserve(count);
+    orbit_radius.reserve(count);
+    orbit_freq.reserve(count);
+    spin_freq.reserve(count);
+    tilt_cos.reserve(count);
+    tilt_sin.reserve(count);
+    scale.reserve(count);
+    pos_x.reserve(count);
+    pos_y.reserve(count);
+    pos_z.reserve(count);
+    world.reserve(count);
+}
+
+void BodyRegistry::clear() {
+    parent.clear();
+    orbit_radius.clear();
+    orbit_freq.clear();
+    spin_freq.clear();
+    tilt_cos.clear();
+    tilt_sin.clear();
+    scale.clear();
+    pos_x.clear();
+    pos_y.clear();
+    pos_z.clear();
+    world.clear();
+    evaluated = false;
+}
+
+void BodyRegistry::seek(SimTick tick) {
+    if (evaluated && tick == current_tick)
+        return;
+    evaluate(tick, NULL, NULL, NULL);
+    current_tick = tick;
+    evaluated = true;
+}
+
+void BodyRegistry::seek(SimTick tick, const float *x, const float *y, const float *z) {
+    evaluate(tick, x, y, z);
+    current_tick = tick;
+    // positions came from outside, so the tick alone no longer identifies this state
+    evaluated = false;
+}
+
+void BodyRegistry::evaluate(SimTick tick, const float *given_x, const float *given_y, const float *given_z) {
+    // angles are reduced to a fraction of a turn in double before dropping to float
+    const double whole_days = (double) (tick / SIM_TICKS_PER_DAY);
+    const double part_day = (double) (tick % SIM_TICKS_PER_DAY) / (double) SIM_TICKS_PER_DAY;
+
+    const size_t count = size();
+    orbit_sin.resize(count);
+    orbit_cos.resize(count);
+    spin_sin.resize(count);
+    spin_cos.resize(count);
+
+    // all angles first, then sine and cosine for whole columns at once
+    for (size_t i = 0; i < count; i++)
+        spin_sin[i] = TWO_PI * (float) sim_turn_fraction(whole_days, part_day, spin_freq[i]);
+    sincos_array(spin_sin.data(), spin_sin.data(), spin_cos.data(), count, trig_accuracy);
+    if (!given_x) {
+        for (size_t i = 0; i < count; i++)
+            orbit_sin[i] = TWO_PI * (float) sim_turn_fraction(whole_days, part_day, orbit_freq[i]);
+        sincos_array(orbit_sin.data(), orbit_sin.data(), orbit_cos.data(), count, trig_accuracy);
+    }
+
+    const int32_t *par = parent.data();
+    float *px = pos_x.data();
+    float *py = pos_y.data();
+    float *pz = pos_z.data();
+    glm::mat4 *out = world.data();
+
+    for (size_t i = 0; i < count; i++) {
+        float x, y, z;
+        if (given_x) {
+            x = given_x[i];
+            y = given_y[i];
+            z = given_z[i];
+        } else {
+            int32_t p = par[i];
+            float center_x = p < 0 ? 0.0f : px[p];
+            float center_y = p < 0 ? 0.0f : py[p];
+            float center_z = p < 0 ? 0.0f : pz[p];
+
+            x = center_x + orbit_radius[i] * orbit_cos[i];
+            y = center_y;
+            z = center_z - orbit_radius[i] * orbit_sin[i];
+        }
+        px[i] = x;
+        py[i] = y;
+        pz[i] = z;
+
+        // translate * scale * rotate_z(tilt) * rotate_y(spin), written out column by column
+        float cs = spin_cos[i], ss = spin_sin[i];
+        float ct = tilt_cos[i], st = tilt_sin[i];
+        float s = scale[i];
+
+        glm::mat4 &m = out[i];
+        m[0] = glm::vec4(s * ct * cs, s * st * cs, -s * ss, 0.0f);
+        m[1] = glm::vec4(-s * st, s * ct, 0.0f, 0.0f);
+        m[2] = glm::vec4(s * ct * ss, s * st * ss, s * cs, 0.0f);
+        m[3] = glm::vec4(x, y, z, 1.0f);
+    }
+}
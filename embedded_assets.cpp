@@ -0,0 +1,45 @@
+#include <embedded_assets.h>
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::string asset_directory;
+
+const EmbeddedAsset *find_embedded_asset(const std::string &path) {
+    size_t count;
+    const EmbeddedAsset *assets = embedded_assets(count);
+    for (size_t i = 0; i < count; i++)
+        if (path == assets[i].path)
+            return &assets[i];
+    return NULL;
+}
+
+void set_asset_directory(const std::string &directory) {
+    asset_directory = directory;
+}
+
+std::string asset_file(const std::string &path) {
+    if (!asset_directory.empty())
+        return (std::filesystem::path(asset_directory) / path).string();
+    return find_embedded_asset(path) != NULL ? std::string() : path;
+}
+
+bool load_asset(const std::string &path, std::string &data) {
+    std::string file_path = asset_file(path);
+    if (file_path.empty()) {
+        const EmbeddedAsset *asset = find_embedded_asset(path);
+        data.assign(asset->data, asset->size);
+        return true;
+    }
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file) {
+        std::cout << "ERROR::ASSET::NOT_FOUND: " << file_path << std::endl;
+        return false;
+    }
+    std::stringstream stream;
+    stream << file.rdbuf();
+    data = stream.str();
+    return true;
+}
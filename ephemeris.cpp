@@ -0,0 +1,331 @@
+#include <ephemeris.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static const double PI = 3.14159265358979323846;
+// trailing terms a candidate segment length has to drop under the tolerance to count as
+// converged; fewer let longer segments through whose error exceeds the tolerance
+static const uint32_t CONVERGED_TERMS = 4;
+static const char EPHEMERIS_MAGIC[8] = {'S', 'S', 'E', 'P', 'H', 'E', 'M', '1'};
+
+// sum of c[k] * T_k(tau) with the Clenshaw recurrence
+static float clenshaw(const float *c, uint32_t count, float tau) {
+    float b1 = 0.0f, b2 = 0.0f;
+    float two_tau = 2.0f * tau;
+    for (uint32_t k = count - 1; k >= 1; k--) {
+        float b0 = two_tau * b1 - b2 + c[k];
+        b2 = b1;
+        b1 = b0;
+    }
+    return tau * b1 - b2 + c[0];
+}
+
+// chebyshev coefficients of the n values sampled at the nodes of a segment
+static void chebyshev_transform(const double *f, uint32_t n, double *out) {
+    for (uint32_t k = 0; k < n; k++) {
+        double sum = 0.0;
+        for (uint32_t j = 0; j < n; j++)
+            sum += f[j] * std::cos(PI * k * (j + 0.5) / n);
+        out[k] = (k == 0 ? 1.0 : 2.0) * sum / n;
+    }
+}
+
+EphemerisTable EphemerisTable::fit(const EphemerisSampler &sample, size_t body_count,
+                                   SimTick start, SimTick end, const std::vector<EphemerisFit> &fits) {
+    struct SamplePoint {
+        SimTick tick;
+        uint32_t body;
+        uint32_t index;  // position of the sample in the body's value array
+    };
+
+    // every body is sampled at the chebyshev nodes of each of its segments
+    std::vector<std::vector<double>> values(body_count);
+    std::vector<SamplePoint> points;
+    std::vector<uint32_t> segment_counts(body_count);
+    for (size_t b = 0; b < body_count; b++) {
+        const EphemerisFit &f = fits[b];
+        const uint32_t n = std::max<uint32_t>(f.max_coefficients, 1);
+        const uint32_t segments = (uint32_t) std::max<SimTick>((end - start + f.segment_ticks - 1) / f.segment_ticks, 1);
+        segment_counts[b] = segments;
+        values[b].resize((size_t) segments * 3 * n);
+        for (uint32_t s = 0; s < segments; s++) {
+            for (uint32_t j = 0; j < n; j++) {
+                double node = std::cos(PI * (j + 0.5) / n);
+                SimTick tick = start + s * f.segment_ticks
+                               + (SimTick) std::llround(0.5 * (node + 1.0) * (double) f.segment_ticks);
+                points.push_back({tick, (uint32_t) b, s * 3 * n + j});
+            }
+        }
+    }
+    std::stable_sort(points.begin(), points.end(), [](const SamplePoint &a, const SamplePoint &b) {
+        return a.tick < b.tick;
+    });
+
+    std::vector<float> x(body_count), y(body_count), z(body_count);
+    for (size_t p = 0; p < points.size();) {
+        SimTick tick = points[p].tick;
+        sample(tick, x.data(), y.data(), z.data());
+        for (; p < points.size() && points[p].tick == tick; p++) {
+            const SamplePoint &point = points[p];
+            const uint32_t n = std::max<uint32_t>(fits[point.body].max_coefficients, 1);
+            std::vector<double> &v = values[point.body];
+            v[point.index] = x[point.body];
+            v[point.index + n] = y[point.body];
+            v[point.index + 2 * n] = z[point.body];
+        }
+    }
+
+    EphemerisTable table;
+    table.start = start;
+    std::vector<double> c;
+    for (size_t b = 0; b < body_count; b++) {
+        const uint32_t n = std::max<uint32_t>(fits[b].max_coefficients, 1);
+        const uint32_t segments = segment_counts[b];
+        const std::vector<double> &v = values[b];
+
+        // discrete chebyshev transform of each segment and axis
+        c.assign(v.size(), 0.0);
+        for (size_t series = 0; series < (size_t) segments * 3; series++)
+            chebyshev_transform(&v[series * n], n, &c[series * n]);
+
+        // drop trailing terms while the worst case error they can add stays under the tolerance
+        uint32_t kept = n;
+        while (kept > 1) {
+            double worst = 0.0;
+            for (size_t series = 0; series < (size_t) segments * 3; series++) {
+                double tail = 0.0;
+                for (uint32_t k = kept - 1; k < n; k++)
+                    tail += std::fabs(c[series * n + k]);
+                worst = std::max(worst, tail);
+            }
+            if (worst > fits[b].tolerance)
+                break;
+            kept--;
+        }
+
+        Track track;
+        track.segment_ticks = fits[b].segment_ticks;
+        track.segment_count = segments;
+        track.coefficient_count = kept;
+        track.offset = table.coefficients.size();
+        table.tracks.push_back(track);
+        for (size_t series = 0; series < (size_t) segments * 3; series++)
+            for (uint32_t k = 0; k < kept; k++)
+                table.coefficients.push_back((float) c[series * n + k]);
+    }
+    return table;
+}
+
+std::vector<EphemerisFit> EphemerisTable::choose_segments(const EphemerisSampler &sample, size_t body_count,
+                                                          SimTick start, SimTick end, SimTick max_segment_ticks,
+                                                          const std::vector<EphemerisFit> &fits) {
+    // candidates sharing a length and a term count share their sample ticks, so they form one
+    // group; every candidate only keeps the segment being sampled and, per term, the largest
+    // tail any of its segments had, which is all the trimming of fit looks at
+    struct Group {
+        SimTick segment_ticks;
+        uint32_t n;
+        uint32_t received = 0;  // nodes of the current segment sampled so far
+        std::vector<uint32_t> bodies;
+        std::vector<double> values;     // 3 * n per body, the current segment
+        std::vector<double> worst_tail;  // n per body
+    };
+    std::vector<Group> groups;
+    std::vector<std::vector<size_t>> body_groups(body_count);
+    for (size_t b = 0; b < body_count; b++) {
+        const uint32_t n = std::max<uint32_t>(fits[b].max_coefficients, 1);
+        for (SimTick length = fits[b].segment_ticks;; length *= 2) {
+            size_t g = 0;
+            while (g < groups.size() && !(groups[g].segment_ticks == length && groups[g].n == n))
+                g++;
+            if (g == groups.size())
+                groups.push_back({length, n});
+            groups[g].bodies.push_back((uint32_t) b);
+            body_groups[b].push_back(g);
+            if (length * 2 > max_segment_ticks)
+                break;
+        }
+    }
+
+    struct NodeTick {
+        SimTick tick;
+        uint32_t group;
+        uint32_t node;
+    };
+    std::vector<NodeTick> ticks;
+    for (size_t g = 0; g < groups.size(); g++) {
+        Group &group = groups[g];
+        group.values.assign(group.bodies.size() * 3 * group.n, 0.0);
+        group.worst_tail.assign(group.bodies.size() * group.n, 0.0);
+        const SimTick segments = std::max<SimTick>((end - start + group.segment_ticks - 1) / group.segment_ticks, 1);
+        for (SimTick s = 0; s < segments; s++) {
+            for (uint32_t j = 0; j < group.n; j++) {
+                double node = std::cos(PI * (j + 0.5) / group.n);
+                SimTick tick = start + s * group.segment_ticks
+                               + (SimTick) std::llround(0.5 * (node + 1.0) * (double) group.segment_ticks);
+                ticks.push_back({tick, (uint32_t) g, j});
+            }
+        }
+    }
+    std::stable_sort(ticks.begin(), ticks.end(), [](const NodeTick &a, const NodeTick &b) {
+        return a.tick < b.tick;
+    });
+
+    std::vector<float> x(body_count), y(body_count), z(body_count);
+    std::vector<double> c;
+    for (size_t p = 0; p < ticks.size();) {
+        SimTick tick = ticks[p].tick;
+        sample(tick, x.data(), y.data(), z.data());
+        for (; p < ticks.size() && ticks[p].tick == tick; p++) {
+            Group &group = groups[ticks[p].group];
+            const uint32_t n = group.n, j = ticks[p].node;
+            for (size_t i = 0; i < group.bodies.size(); i++) {
+                double *v = &group.values[i * 3 * n];
+                v[j] = x[group.bodies[i]];
+                v[j + n] = y[group.bodies[i]];
+                v[j + 2 * n] = z[group.bodies[i]];
+            }
+            if (++group.received < n)
+                continue;
+
+            // a segment is complete: transform it and keep the worst tails
+            group.received = 0;
+            c.resize(n);
+            for (size_t i = 0; i < group.bodies.size(); i++) {
+                double *worst = &group.worst_tail[i * n];
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                    chebyshev_transform(&group.values[(i * 3 + axis) * n], n, c.data());
+                    double tail = 0.0;
+                    for (uint32_t k = n; k-- > 0;) {
+                        tail += std::fabs(c[k]);
+                        worst[k] = std::max(worst[k], tail);
+                    }
+                }
+            }
+        }
+    }
+
+    // per body the candidate storing the fewest terms per tick among those that converge
+    std::vector<EphemerisFit> chosen(fits.begin(), fits.begin() + body_count);
+    for (size_t b = 0; b < body_count; b++) {
+        double best = 0.0;
+        for (size_t g: body_groups[b]) {
+            const Group &group = groups[g];
+            const size_t i = std::find(group.bodies.begin(), group.bodies.end(), (uint32_t) b) - group.bodies.begin();
+            const double *worst = &group.worst_tail[i * group.n];
+            uint32_t kept = group.n;
+            while (kept > 1 && worst[kept - 1] <= fits[b].tolerance)
+                kept--;
+            if (kept + CONVERGED_TERMS > group.n)
+                continue;
+            double per_tick = (double) kept / (double) group.segment_ticks;
+            if (best == 0.0 || per_tick < best) {
+                best = per_tick;
+                chosen[b].segment_ticks = group.segment_ticks;
+            }
+        }
+    }
+    return chosen;
+}
+
+SimTick EphemerisTable::end_tick() const {
+    SimTick end = start;
+    for (const Track &t: tracks)
+        end = std::max(end, start + t.segment_ticks * t.segment_count);
+    return end;
+}
+
+size_t EphemerisTable::byte_size() const {
+    return sizeof(EPHEMERIS_MAGIC) + 2 * sizeof(uint32_t) + sizeof(SimTick)
+           + tracks.size() * (sizeof(SimTick) + 2 * sizeof(uint32_t))
+           + coefficients.size() * sizeof(float);
+}
+
+const float *EphemerisTable::segment(size_t body, SimTick tick, float &tau) const {
+    const Track &t = tracks[body];
+    SimTick rel = tick - start;
+    SimTick index = rel < 0 ? 0 : std::min<SimTick>(rel / t.segment_ticks, t.segment_count - 1);
+    double local = 2.0 * (double) (rel - index * t.segment_ticks) / (double) t.segment_ticks - 1.0;
+    tau = (float) std::min(std::max(local, -1.0), 1.0);
+    return &coefficients[t.offset + (size_t) index * 3 * t.coefficient_count];
+}
+
+glm::vec3 EphemerisTable::position(size_t body, SimTick tick) const {
+    float tau;
+    const float *c = segment(body, tick, tau);
+    const uint32_t n = tracks[body].coefficient_count;
+    return {clenshaw(c, n, tau), clenshaw(c + n, n, tau), clenshaw(c + 2 * n, n, tau)};
+}
+
+void EphemerisTable::evaluate(SimTick tick, float *x, float *y, float *z) const {
+    for (size_t b = 0; b < tracks.size(); b++) {
+        float tau;
+        const float *c = segment(b, tick, tau);
+        const uint32_t n = tracks[b].coefficient_count;
+        x[b] = clenshaw(c, n, tau);
+        y[b] = clenshaw(c + n, n, tau);
+        z[b] = clenshaw(c + 2 * n, n, tau);
+    }
+}
+
+// file layout, native byte order:
+//   magic[8], uint32 version, uint32 body_count, int64 start_tick,
+//   per body: int64 segment_ticks, uint32 segment_count, uint32 coefficient_count,
+//   then every body's float coefficients back to back
+bool EphemerisTable::save(const std::string &path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cout << "ERROR::EPHEMERIS::FILE_NOT_WRITABLE: " << path << std::endl;
+        return false;
+    }
+    uint32_t version = 1, count = (uint32_t) tracks.size();
+    out.write(EPHEMERIS_MAGIC, sizeof(EPHEMERIS_MAGIC));
+    out.write((const char *) &version, sizeof(version));
+    out.write((const char *) &count, sizeof(count));
+    out.write((const char *) &start, sizeof(start));
+    for (const Track &t: tracks) {
+        out.write((const char *) &t.segment_ticks, sizeof(t.segment_ticks));
+        out.write((const char *) &t.segment_count, sizeof(t.segment_count));
+        out.write((const char *) &t.coefficient_count, sizeof(t.coefficient_count));
+    }
+    out.write((const char *) coefficients.data(), (std::streamsize) (coefficients.size() * sizeof(float)));
+    return (bool) out;
+}
+
+bool EphemerisTable::load(const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(EPHEMERIS_MAGIC)];
+    uint32_t version = 0, count = 0;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, EPHEMERIS_MAGIC, sizeof(magic)) != 0
+        || !in.read((char *) &version, sizeof(version)) || version != 1) {
+        std::cout << "ERROR::EPHEMERIS::NOT_AN_EPHEMERIS_FILE: " << path << std::endl;
+        return false;
+    }
+    in.read((char *) &count, sizeof(count));
+    in.read((char *) &start, sizeof(start));
+
+    tracks.resize(count);
+    uint64_t total = 0;
+    for (Track &t: tracks) {
+        in.read((char *) &t.segment_ticks, sizeof(t.segment_ticks));
+        in.read((char *) &t.segment_count, sizeof(t.segment_count));
+        in.read((char *) &t.coefficient_count, sizeof(t.coefficient_count));
+        t.offset = total;
+        total += (uint64_t) t.segment_count * 3 * t.coefficient_count;
+        if (t.segment_ticks <= 0 || t.segment_count == 0 || t.coefficient_count == 0)
+            in.setstate(std::ios::failbit);
+    }
+    if (in)
+        coefficients.resize(total);
+    if (!in || !in.read((char *) coefficients.data(), (std::streamsize) (total * sizeof(float)))) {
+        std::cout << "ERROR::EPHEMERIS::FILE_TRUNCATED: " << path << std::endl;
+        tracks.clear();
+        coefficients.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#include <fast_trig.h>
+
+#include <cmath>
+
+template<void (*kernel)(vfloat, vfloat &, vfloat &)>
+static void sincos_columns(const float *angles, float *s, float *c, size_t count) {
+    size_t i = 0;
+    for (; i + SIMD_FLOAT_WIDTH <= count; i += SIMD_FLOAT_WIDTH) {
+        vfloat vs, vc;
+        kernel(v_loadu(angles + i), vs, vc);
+        v_storeu(s + i, vs);
+        v_storeu(c + i, vc);
+    }
+    if (i == count)
+        return;
+
+    // the last partial vector goes through a bounce buffer
+    float in[SIMD_FLOAT_WIDTH] = {0.0f}, out_s[SIMD_FLOAT_WIDTH], out_c[SIMD_FLOAT_WIDTH];
+    for (size_t k = i; k < count; k++)
+        in[k - i] = angles[k];
+    vfloat vs, vc;
+    kernel(v_loadu(in), vs, vc);
+    v_storeu(out_s, vs);
+    v_storeu(out_c, vc);
+    for (size_t k = i; k < count; k++) {
+        s[k] = out_s[k - i];
+        c[k] = out_c[k - i];
+    }
+}
+
+void sincos_array(const float *angles, float *s, float *c, size_t count, TrigAccuracy accuracy) {
+    switch (accuracy) {
+        case TrigAccuracy::Fast:
+            sincos_columns<v_sincos_fast>(angles, s, c, count);
+            break;
+        case TrigAccuracy::Medium:
+            sincos_columns<v_sincos>(angles, s, c, count);
+            break;
+        case TrigAccuracy::Exact:
+            for (size_t i = 0; i < count; i++) {
+                double angle = angles[i];
+                s[i] = (float) std::sin(angle);
+                c[i] = (float) std::cos(angle);
+            }
+            break;
+    }
+}
@@ -0,0 +1,80 @@
+#include <file_watcher.h>
+
+#include <iostream>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher() {
+#ifdef __linux__
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0)
+        std::cout << "ERROR::FILE_WATCHER::INOTIFY_NOT_AVAILABLE: falling back to polling" << std::endl;
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#ifdef __linux__
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+#endif
+}
+
+bool FileWatcher::watch(const std::string &path) {
+    for (const WatchedFile &file: files)
+        if (file.path == path)
+            return true;
+    std::error_code error;
+    std::filesystem::path file_path(path);
+    WatchedFile file{path, file_path.parent_path(), file_path.filename().string(),
+                     std::filesystem::last_write_time(file_path, error), -1};
+    if (error) {
+        std::cout << "ERROR::FILE_WATCHER::NOT_FOUND: " << path << std::endl;
+        return false;
+    }
+    if (file.directory.empty())
+        file.directory = ".";
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        // watching a directory again returns the descriptor it already has
+        file.watch_descriptor = inotify_add_watch(inotify_fd, file.directory.c_str(),
+                                                  IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (file.watch_descriptor < 0)
+            std::cout << "ERROR::FILE_WATCHER::NOT_WATCHED: " << path << ", falling back to polling" << std::endl;
+    }
+#endif
+    files.push_back(file);
+    return true;
+}
+
+bool FileWatcher::poll() {
+    bool changed = false;
+#ifdef __linux__
+    if (inotify_fd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t length;
+        while ((length = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const inotify_event *event = (const inotify_event *) (buffer + offset);
+                offset += (ssize_t) (sizeof(inotify_event) + event->len);
+                for (const WatchedFile &file: files)
+                    changed |= event->len > 0 && file.watch_descriptor == event->wd && file.name == event->name;
+            }
+        }
+    }
+#endif
+    // files without an inotify watch are compared by modification time
+    for (WatchedFile &file: files) {
+        if (file.watch_descriptor >= 0)
+            continue;
+        std::error_code error;
+        std::filesystem::file_time_type modified = std::filesystem::last_write_time(file.path, error);
+        if (!error && modified != file.modified) {
+            file.modified = modified;
+            changed = true;
+        }
+    }
+    return changed;
+}
@@ -0,0 +1,94 @@
+#include <frame_pacer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef __linux__
+#include <time.h>
+#endif
+
+// the OS sleep may overshoot by up to this much, so the final stretch is spun out
+static const std::chrono::microseconds SPIN_MARGIN(1500);
+
+// sleep until an absolute point on the steady clock
+static void sleep_until(std::chrono::steady_clock::time_point until) {
+#ifdef __linux__
+    // steady_clock is CLOCK_MONOTONIC here; an absolute deadline does not drift when the sleep is interrupted
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(until.time_since_epoch()).count();
+    timespec ts;
+    ts.tv_sec = (time_t) (since_epoch / 1000000000);
+    ts.tv_nsec = (long) (since_epoch % 1000000000);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0) {}
+#else
+    std::this_thread::sleep_until(until);
+#endif
+}
+
+FramePacer::FramePacer(double frames_per_second) {
+    set_rate(frames_per_second);
+}
+
+void FramePacer::set_rate(double frames_per_second) {
+    period = std::chrono::duration<double>(1.0 / std::max(frames_per_second, 1.0));
+    started = false;
+}
+
+void FramePacer::wait() {
+    const Clock::duration step = std::chrono::duration_cast<Clock::duration>(period);
+    Clock::time_point now = Clock::now();
+    if (!started) {
+        deadline = now;
+        started = true;
+    }
+
+    if (now < deadline) {
+        if (deadline - now > SPIN_MARGIN)
+            sleep_until(deadline - SPIN_MARGIN);
+        while (Clock::now() < deadline) {}
+    } else if (now - deadline > step) {
+        deadline = now;
+    }
+    // the next deadline follows from this one, not from when the wait ended, so errors do not add up
+    deadline += step;
+}
+
+void FramePacer::frame_presented(Clock::time_point when) {
+    if (presented) {
+        double ms = std::chrono::duration<double, std::milli>(when - last_present).count();
+        if (intervals == 0) {
+            shortest = ms;
+            longest = ms;
+        }
+        shortest = std::min(shortest, ms);
+        longest = std::max(longest, ms);
+        sum += ms;
+        sum_squares += ms * ms;
+        intervals++;
+        if (ms > 1500.0 * period.count())
+            missed++;
+    }
+    last_present = when;
+    presented = true;
+}
+
+FramePacingStats FramePacer::stats() const {
+    FramePacingStats s;
+    s.frames = intervals;
+    if (intervals == 0)
+        return s;
+    s.mean_ms = sum / (double) intervals;
+    s.jitter_ms = std::sqrt(std::max(sum_squares / (double) intervals - s.mean_ms * s.mean_ms, 0.0));
+    s.min_ms = shortest;
+    s.max_ms = longest;
+    s.missed = missed;
+    return s;
+}
+
+void FramePacer::reset_stats() {
+    // the interval running into the next frame still counts
+    intervals = 0;
+    missed = 0;
+    sum = 0.0;
+    sum_squares = 0.0;
+}
@@ -0,0 +1,80 @@
+#include <frame_packet.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+// one chunk: sort its bodies front to back, so the depth test rejects what is hidden before it is
+// shaded, then write their matrices and the command drawing them
+static void record_chunk(const BodyRegistry &bodies, float far_plane, FramePacket &packet, size_t chunk,
+                         size_t chunk_bodies) {
+    const glm::mat4 *world = bodies.world_matrices();
+    const glm::mat4 &view = packet.view;
+    const size_t first = chunk * chunk_bodies;
+    const size_t count = std::min(chunk_bodies, bodies.size() - first);
+
+    // the key is the view distance's float bits, which sort like the distance as it is never
+    // negative, above the body index
+    std::vector<uint64_t> &order = packet.chunk_order[chunk];
+    order.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        const glm::vec4 &position = world[first + i][3];
+        float distance = -(view[0][2] * position.x + view[1][2] * position.y + view[2][2] * position.z + view[3][2]);
+        distance = std::max(distance, 0.0f);
+        uint32_t bits;
+        std::memcpy(&bits, &distance, sizeof(bits));
+        order[i] = ((uint64_t) bits << 32) | (uint64_t) (first + i);
+    }
+    radix_sort(order, packet.chunk_scratch[chunk], [](uint64_t key) { return key; });
+
+    glm::mat4 *instances = packet.instances.data() + first;
+    if (packet.transform == InstanceTransform::ModelViewProjection) {
+        const glm::mat4 view_projection = packet.projection * view;
+        for (size_t i = 0; i < count; i++)
+            instances[i] = view_projection * world[(uint32_t) order[i]];
+    } else {
+        for (size_t i = 0; i < count; i++)
+            instances[i] = world[(uint32_t) order[i]];
+    }
+
+    // chunks are drawn nearest first too
+    float nearest = 0.0f;
+    if (count > 0) {
+        uint32_t bits = (uint32_t) (order[0] >> 32);
+        std::memcpy(&nearest, &bits, sizeof(nearest));
+    }
+    DrawCommand &command = packet.commands[chunk];
+    command = DrawCommand();
+    command.key = make_sort_key(RENDER_LAYER_OPAQUE, 0, MESH_CUBE, 0, nearest / far_plane);
+    command.first_instance = (uint32_t) first;
+    command.instance_count = (uint32_t) count;
+}
+
+void record_frame(const BodyRegistry &bodies, int32_t focus, const SceneCamera &camera, float aspect,
+                  InstanceTransform transform, FramePacket &packet, ThreadPool *pool, size_t chunk_bodies) {
+    packet.view = glm::lookAt(camera.eye, bodies.world_position(focus), glm::vec3(0.0f, 1.0f, 0.0f));
+    packet.projection = glm::perspective(glm::radians(camera.fov_degrees), aspect, camera.near_plane,
+                                         camera.far_plane);
+    packet.eye = camera.eye;
+    packet.time = (float) sim_days(bodies.evaluated_tick());
+    packet.transform = transform;
+
+    const size_t count = bodies.size();
+    chunk_bodies = std::max<size_t>(chunk_bodies, 1);
+    const size_t chunks = (count + chunk_bodies - 1) / chunk_bodies;
+    packet.instances.resize(count);
+    packet.commands.resize(chunks);
+    packet.chunk_order.resize(chunks);
+    packet.chunk_scratch.resize(chunks);
+
+    const float far_plane = camera.far_plane;
+    auto record_chunks = [&bodies, far_plane, &packet, chunk_bodies](size_t begin, size_t end) {
+        for (size_t chunk = begin; chunk < end; chunk++)
+            record_chunk(bodies, far_plane, packet, chunk, chunk_bodies);
+    };
+    if (pool != NULL && chunks > 1)
+        pool->parallel_for(chunks, 1, record_chunks);
+    else
+        record_chunks(0, chunks);
+}
@@ -0,0 +1,236 @@
+#include <gl_state_cache.h>
+
+#include <iostream>
+
+int GLStateCache::buffer_slot(GLenum target) {
+    switch (target) {
+        case GL_ARRAY_BUFFER:
+            return ARRAY_BUFFER;
+        case GL_UNIFORM_BUFFER:
+            return UNIFORM_BUFFER;
+        case GL_PIXEL_PACK_BUFFER:
+            return PIXEL_PACK_BUFFER;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return PIXEL_UNPACK_BUFFER;
+        case GL_COPY_READ_BUFFER:
+            return COPY_READ_BUFFER;
+        case GL_COPY_WRITE_BUFFER:
+            return COPY_WRITE_BUFFER;
+        default:
+            return -1;
+    }
+}
+
+int GLStateCache::capability_slot(GLenum capability) {
+    switch (capability) {
+        case GL_DEPTH_TEST:
+            return DEPTH_TEST;
+        case GL_BLEND:
+            return BLEND;
+        case GL_CULL_FACE:
+            return CULL_FACE;
+        default:
+            return -1;
+    }
+}
+
+bool GLStateCache::record(bool changes) {
+    if (changes)
+        stats.issued++;
+    else
+        stats.filtered++;
+    return changes;
+}
+
+void GLStateCache::check() const {
+    if (verify_calls)
+        verify();
+}
+
+void GLStateCache::use_program(GLuint id) {
+    if (record(program != id)) {
+        glUseProgram(id);
+        program = id;
+    }
+    check();
+}
+
+void GLStateCache::bind_vertex_array(GLuint id) {
+    if (record(vertex_array != id)) {
+        glBindVertexArray(id);
+        vertex_array = id;
+    }
+    check();
+}
+
+void GLStateCache::bind_buffer(GLenum target, GLuint buffer) {
+    int slot = buffer_slot(target);
+    if (record(slot < 0 || buffers[slot] != buffer)) {
+        glBindBuffer(target, buffer);
+        if (slot >= 0)
+            buffers[slot] = buffer;
+    }
+    check();
+}
+
+void GLStateCache::bind_buffer_base(GLenum target, GLuint index, GLuint buffer) {
+    bool tracked = target == GL_UNIFORM_BUFFER && index < UNIFORM_BUFFER_BINDINGS;
+    if (record(!tracked || uniform_buffers[index] != buffer || buffers[UNIFORM_BUFFER] != buffer)) {
+        glBindBufferBase(target, index, buffer);
+        if (tracked)
+            uniform_buffers[index] = buffer;
+        int slot = buffer_slot(target);
+        if (slot >= 0)
+            buffers[slot] = buffer;
+    }
+    check();
+}
+
+void GLStateCache::active_texture(GLuint unit) {
+    if (record(active_unit != unit)) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        active_unit = unit;
+    }
+}
+
+void GLStateCache::bind_texture(GLuint unit, GLenum target, GLuint texture) {
+    bool tracked = target == GL_TEXTURE_2D && unit < TEXTURE_UNITS;
+    if (!tracked || textures_2d[unit] != texture) {
+        active_texture(unit);
+        record(true);
+        glBindTexture(target, texture);
+        if (tracked)
+            textures_2d[unit] = texture;
+    } else {
+        record(false);
+    }
+    check();
+}
+
+void GLStateCache::set_enabled(GLenum capability, bool enabled) {
+    int slot = capability_slot(capability);
+    if (record(slot < 0 || capabilities[slot] != (GLuint) enabled)) {
+        if (enabled)
+            glEnable(capability);
+        else
+            glDisable(capability);
+        if (slot >= 0)
+            capabilities[slot] = (GLuint) enabled;
+    }
+    check();
+}
+
+void GLStateCache::depth_func(GLenum func) {
+    if (record(depth_function != func)) {
+        glDepthFunc(func);
+        depth_function = func;
+    }
+    check();
+}
+
+void GLStateCache::blend_func(GLenum source, GLenum destination) {
+    if (record(blend_source != source || blend_destination != destination)) {
+        glBlendFunc(source, destination);
+        blend_source = source;
+        blend_destination = destination;
+    }
+    check();
+}
+
+void GLStateCache::cull_face(GLenum mode) {
+    if (record(cull_mode != mode)) {
+        glCullFace(mode);
+        cull_mode = mode;
+    }
+    check();
+}
+
+void GLStateCache::viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    if (record(!viewport_known || viewport_box[0] != x || viewport_box[1] != y || viewport_box[2] != width
+               || viewport_box[3] != height)) {
+        glViewport(x, y, width, height);
+        viewport_box[0] = x;
+        viewport_box[1] = y;
+        viewport_box[2] = width;
+        viewport_box[3] = height;
+        viewport_known = true;
+    }
+    check();
+}
+
+void GLStateCache::invalidate() {
+    program = vertex_array = active_unit = UNKNOWN;
+    for (GLuint &buffer: buffers)
+        buffer = UNKNOWN;
+    for (GLuint &buffer: uniform_buffers)
+        buffer = UNKNOWN;
+    for (GLuint &texture: textures_2d)
+        texture = UNKNOWN;
+    for (GLuint &capability: capabilities)
+        capability = UNKNOWN;
+    depth_function = blend_source = blend_destination = cull_mode = UNKNOWN;
+    viewport_known = false;
+}
+
+// one known value against what the driver reports
+static bool matches(const char *name, GLuint cached, GLint actual) {
+    if (cached == 0xFFFFFFFFu || cached == (GLuint) actual)
+        return true;
+    std::cout << "ERROR::GL_STATE::MISMATCH: " << name << " cached " << cached << ", actual " << actual << std::endl;
+    return false;
+}
+
+static GLint get_integer(GLenum name) {
+    GLint value = 0;
+    glGetIntegerv(name, &value);
+    return value;
+}
+
+bool GLStateCache::verify() const {
+    bool ok = matches("program", program, get_integer(GL_CURRENT_PROGRAM));
+    ok &= matches("vertex array", vertex_array, get_integer(GL_VERTEX_ARRAY_BINDING));
+    ok &= matches("array buffer", buffers[ARRAY_BUFFER], get_integer(GL_ARRAY_BUFFER_BINDING));
+    ok &= matches("uniform buffer", buffers[UNIFORM_BUFFER], get_integer(GL_UNIFORM_BUFFER_BINDING));
+    ok &= matches("pixel pack buffer", buffers[PIXEL_PACK_BUFFER], get_integer(GL_PIXEL_PACK_BUFFER_BINDING));
+    ok &= matches("pixel unpack buffer", buffers[PIXEL_UNPACK_BUFFER], get_integer(GL_PIXEL_UNPACK_BUFFER_BINDING));
+    // GL 3.3 has no separate binding queries for the copy targets; the targets themselves answer
+    ok &= matches("copy read buffer", buffers[COPY_READ_BUFFER], get_integer(GL_COPY_READ_BUFFER));
+    ok &= matches("copy write buffer", buffers[COPY_WRITE_BUFFER], get_integer(GL_COPY_WRITE_BUFFER));
+    for (GLuint index = 0; index < UNIFORM_BUFFER_BINDINGS; index++) {
+        GLint actual = 0;
+        glGetIntegeri_v(GL_UNIFORM_BUFFER_BINDING, index, &actual);
+        ok &= matches("indexed uniform buffer", uniform_buffers[index], actual);
+    }
+
+    GLint unit = get_integer(GL_ACTIVE_TEXTURE) - GL_TEXTURE0;
+    ok &= matches("active texture unit", active_unit, unit);
+    for (GLuint i = 0; i < TEXTURE_UNITS; i++) {
+        if (textures_2d[i] == UNKNOWN)
+            continue;
+        // looking at another unit means switching to it for a moment
+        glActiveTexture(GL_TEXTURE0 + i);
+        ok &= matches("2D texture", textures_2d[i], get_integer(GL_TEXTURE_BINDING_2D));
+    }
+    glActiveTexture(GL_TEXTURE0 + (GLuint) unit);
+
+    ok &= matches("depth test", capabilities[DEPTH_TEST], glIsEnabled(GL_DEPTH_TEST));
+    ok &= matches("blend", capabilities[BLEND], glIsEnabled(GL_BLEND));
+    ok &= matches("cull face", capabilities[CULL_FACE], glIsEnabled(GL_CULL_FACE));
+    ok &= matches("depth func", depth_function, get_integer(GL_DEPTH_FUNC));
+    ok &= matches("blend source", blend_source, get_integer(GL_BLEND_SRC_RGB));
+    ok &= matches("blend destination", blend_destination, get_integer(GL_BLEND_DST_RGB));
+    ok &= matches("cull face mode", cull_mode, get_integer(GL_CULL_FACE_MODE));
+    if (viewport_known) {
+        GLint actual[4];
+        glGetIntegerv(GL_VIEWPORT, actual);
+        for (int i = 0; i < 4; i++)
+            ok &= matches("viewport", (GLuint) viewport_box[i], actual[i]);
+    }
+    return ok;
+}
+
+GLStateStats GLStateCache::end_frame() {
+    GLStateStats frame = stats;
+    stats = GLStateStats();
+    return frame;
+}
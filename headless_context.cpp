@@ -0,0 +1,128 @@
+#include <headless_context.h>
+
+#include <iostream>
+#include <mutex>
+
+#ifdef SOLARSYSTEM_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::~HeadlessContext() {
+    destroy();
+}
+
+#ifdef SOLARSYSTEM_EGL
+
+// contexts on other threads share the display, which is only terminated with the last of them.
+// creation is serialized too, since every context loads the same GL function pointers.
+static std::mutex display_mutex;
+static size_t display_users = 0;
+
+bool HeadlessContext::create(uint32_t width, uint32_t height) {
+    destroy();
+    std::lock_guard<std::mutex> lock(display_mutex);
+
+    // the surfaceless platform needs neither a display server nor a GPU
+    EGLDisplay egl_display = EGL_NO_DISPLAY;
+    auto get_platform_display = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display != NULL)
+        egl_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (egl_display == EGL_NO_DISPLAY)
+        egl_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (egl_display == EGL_NO_DISPLAY || !eglInitialize(egl_display, &major, &minor)) {
+        std::cout << "ERROR::HEADLESS::EGL_NOT_INITIALIZED" << std::endl;
+        return false;
+    }
+    display = egl_display;
+    display_users++;
+
+    // nothing is drawn to an EGL surface, so any config will do, or none where the display allows it
+    const EGLint config_attributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = EGL_NO_CONFIG_KHR;
+    EGLint config_count = 0;
+    const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+    };
+    EGLContext egl_context = EGL_NO_CONTEXT;
+    if (eglBindAPI(EGL_OPENGL_API)) {
+        if (!eglChooseConfig(egl_display, config_attributes, &config, 1, &config_count) || config_count == 0)
+            config = EGL_NO_CONFIG_KHR;
+        egl_context = eglCreateContext(egl_display, config, EGL_NO_CONTEXT, context_attributes);
+    }
+    if (egl_context == EGL_NO_CONTEXT) {
+        std::cout << "ERROR::HEADLESS::CONTEXT_NOT_CREATED: EGL " << major << "." << minor << std::endl;
+        release();
+        return false;
+    }
+    context = egl_context;
+
+    if (!eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, egl_context)
+        || !gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        std::cout << "ERROR::HEADLESS::CONTEXT_NOT_CURRENT" << std::endl;
+        release();
+        return false;
+    }
+
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, (GLsizei) width, (GLsizei) height);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, (GLsizei) width, (GLsizei) height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        release();
+        return false;
+    }
+    glViewport(0, 0, (GLsizei) width, (GLsizei) height);
+    return true;
+}
+
+void HeadlessContext::destroy() {
+    std::lock_guard<std::mutex> lock(display_mutex);
+    release();
+}
+
+void HeadlessContext::release() {
+    if (context != nullptr) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (fbo != 0)
+            glDeleteFramebuffers(1, &fbo);
+        if (color != 0)
+            glDeleteRenderbuffers(1, &color);
+        if (depth != 0)
+            glDeleteRenderbuffers(1, &depth);
+        eglMakeCurrent((EGLDisplay) display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay) display, (EGLContext) context);
+    }
+    if (display != nullptr && --display_users == 0)
+        eglTerminate((EGLDisplay) display);
+    display = nullptr;
+    context = nullptr;
+    fbo = color = depth = 0;
+}
+
+#else
+
+bool HeadlessContext::create(uint32_t, uint32_t) {
+    std::cout << "ERROR::HEADLESS::BUILT_WITHOUT_EGL" << std::endl;
+    return false;
+}
+
+void HeadlessContext::destroy() {}
+
+void HeadlessContext::release() {}
+
+#endif
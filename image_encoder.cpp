@@ -0,0 +1,324 @@
+#include <image_encoder.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define IMAGE_ENCODER_SSE2 1
+#endif
+
+// rows per independently deflated PNG strip, about 200 KB of a 1024 pixel wide frame
+static const uint32_t PNG_STRIP_ROWS = 64;
+// zero bytes kept around every row buffer so the filters can read left and past the end freely
+static const size_t ROW_PADDING = 16;
+
+ImageFormat image_format_from_path(const std::string &path) {
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".png")
+        return ImageFormat::PNG;
+    if (extension == ".qoi")
+        return ImageFormat::QOI;
+    return ImageFormat::PPM;
+}
+
+// row y counted from the top, as RGB
+static void fetch_rgb_row(const Image &image, uint32_t y, uint8_t *dst) {
+    uint32_t row = image.bottom_up ? image.height - 1 - y : y;
+    const uint8_t *src = image.pixels.data() + (size_t) row * image.width * image.channels;
+    if (image.channels == 3) {
+        std::memcpy(dst, src, (size_t) image.width * 3);
+        return;
+    }
+    for (uint32_t x = 0; x < image.width; x++) {
+        dst[3 * x] = src[image.channels * x];
+        dst[3 * x + 1] = src[image.channels * x + 1];
+        dst[3 * x + 2] = src[image.channels * x + 2];
+    }
+}
+
+static void put_u32_be(std::vector<uint8_t> &out, uint32_t v) {
+    out.push_back((uint8_t) (v >> 24));
+    out.push_back((uint8_t) (v >> 16));
+    out.push_back((uint8_t) (v >> 8));
+    out.push_back((uint8_t) v);
+}
+
+void encode_ppm(const Image &image, std::vector<uint8_t> &out) {
+    std::string header = "P6\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+    const size_t row_bytes = (size_t) image.width * 3;
+    size_t start = out.size();
+    out.resize(start + header.size() + row_bytes * image.height);
+    std::copy(header.begin(), header.end(), out.begin() + (std::ptrdiff_t) start);
+    uint8_t *dst = out.data() + start + header.size();
+    for (uint32_t y = 0; y < image.height; y++, dst += row_bytes)
+        fetch_rgb_row(image, y, dst);
+}
+
+void encode_qoi(const Image &image, std::vector<uint8_t> &out) {
+    const uint8_t header[4] = {'q', 'o', 'i', 'f'};
+    out.insert(out.end(), header, header + 4);
+    put_u32_be(out, image.width);
+    put_u32_be(out, image.height);
+    out.push_back(3);  // channels
+    out.push_back(0);  // sRGB with linear alpha
+
+    // worst case is four bytes per pixel, reserve it once and write through a pointer
+    size_t start = out.size();
+    out.resize(start + (size_t) image.width * image.height * 4 + 8);
+    uint8_t *dst = out.data() + start;
+
+    // pixels are packed as 0xaabbggrr. every pixel written is opaque, so an index slot still at
+    // its initial transparent black never matches, just as in the decoder
+    uint32_t index[64] = {0};
+    uint32_t prev = 0xff000000u;
+    uint32_t run = 0;
+    std::vector<uint8_t> row((size_t) image.width * 3);
+    for (uint32_t y = 0; y < image.height; y++) {
+        fetch_rgb_row(image, y, row.data());
+        for (uint32_t x = 0; x < image.width; x++) {
+            uint8_t r = row[3 * x], g = row[3 * x + 1], b = row[3 * x + 2];
+            uint32_t px = 0xff000000u | (uint32_t) b << 16 | (uint32_t) g << 8 | r;
+            if (px == prev) {
+                if (++run == 62) {
+                    *dst++ = (uint8_t) (0xc0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                *dst++ = (uint8_t) (0xc0 | (run - 1));
+                run = 0;
+            }
+
+            int slot = (r * 3 + g * 5 + b * 7 + 255 * 11) % 64;
+            if (index[slot] == px) {
+                *dst++ = (uint8_t) slot;
+            } else {
+                index[slot] = px;
+                int dr = (int8_t) (r - (uint8_t) prev), dg = (int8_t) (g - (uint8_t) (prev >> 8));
+                int db = (int8_t) (b - (uint8_t) (prev >> 16));
+                int dr_dg = dr - dg, db_dg = db - dg;
+                if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+                    *dst++ = (uint8_t) (0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dg >= -32 && dg <= 31 && dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7) {
+                    *dst++ = (uint8_t) (0x80 | (dg + 32));
+                    *dst++ = (uint8_t) ((dr_dg + 8) << 4 | (db_dg + 8));
+                } else {
+                    *dst++ = 0xfe;
+                    *dst++ = r;
+                    *dst++ = g;
+                    *dst++ = b;
+                }
+            }
+            prev = px;
+        }
+    }
+    if (run > 0)
+        *dst++ = (uint8_t) (0xc0 | (run - 1));
+    const uint8_t end_marker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    std::memcpy(dst, end_marker, 8);
+    dst += 8;
+    out.resize((size_t) (dst - out.data()));
+}
+
+// Sub, Up and Paeth for one RGB row of n bytes. 'x' and 'p' (the row above, zeros for the first
+// row) have ROW_PADDING zero bytes on both sides. returns the filter with the smallest sum of
+// absolute signed residuals, the usual PNG heuristic, and its output in 'best'.
+static uint8_t filter_row(const uint8_t *x, const uint8_t *p, size_t n,
+                          uint8_t *sub, uint8_t *up, uint8_t *paeth, const uint8_t *&best) {
+    uint64_t cost_sub = 0, cost_up = 0, cost_paeth = 0;
+#ifdef IMAGE_ENCODER_SSE2
+    static const uint8_t TAIL_MASK[32] = {255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255};
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum_sub = zero, sum_up = zero, sum_paeth = zero;
+    // |v| of bytes read as signed, summed into two 64-bit lanes
+    auto cost = [zero](__m128i v, __m128i mask) {
+        return _mm_sad_epu8(_mm_and_si128(_mm_min_epu8(v, _mm_sub_epi8(zero, v)), mask), zero);
+    };
+    auto abs16 = [](__m128i v) { return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v)); };
+    for (size_t i = 0; i < n; i += 16) {
+        __m128i mask = _mm_loadu_si128((const __m128i *) (TAIL_MASK + 16 - std::min<size_t>(n - i, 16)));
+        __m128i cur = _mm_loadu_si128((const __m128i *) (x + i));
+        __m128i a = _mm_loadu_si128((const __m128i *) (x + i - 3));
+        __m128i b = _mm_loadu_si128((const __m128i *) (p + i));
+        __m128i c = _mm_loadu_si128((const __m128i *) (p + i - 3));
+
+        __m128i fs = _mm_sub_epi8(cur, a);
+        __m128i fu = _mm_sub_epi8(cur, b);
+
+        // paeth works on 16-bit lanes: pa = |b - c|, pb = |a - c|, pc = |a + b - 2c|
+        __m128i predicted[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i a16 = half ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i b16 = half ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+            __m128i c16 = half ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            __m128i bc = _mm_sub_epi16(b16, c16), ac = _mm_sub_epi16(a16, c16);
+            __m128i pa = abs16(bc), pb = abs16(ac), pc = abs16(_mm_add_epi16(bc, ac));
+            __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+            __m128i not_b = _mm_cmpgt_epi16(pb, pc);
+            __m128i b_or_c = _mm_or_si128(_mm_andnot_si128(not_b, b16), _mm_and_si128(not_b, c16));
+            predicted[half] = _mm_or_si128(_mm_andnot_si128(not_a, a16), _mm_and_si128(not_a, b_or_c));
+        }
+        __m128i fp = _mm_sub_epi8(cur, _mm_packus_epi16(predicted[0], predicted[1]));
+
+        _mm_storeu_si128((__m128i *) (sub + i), fs);
+        _mm_storeu_si128((__m128i *) (up + i), fu);
+        _mm_storeu_si128((__m128i *) (paeth + i), fp);
+        sum_sub = _mm_add_epi64(sum_sub, cost(fs, mask));
+        sum_up = _mm_add_epi64(sum_up, cost(fu, mask));
+        sum_paeth = _mm_add_epi64(sum_paeth, cost(fp, mask));
+    }
+    auto total = [](__m128i v) {
+        return (uint64_t) _mm_cvtsi128_si32(v) + (uint64_t) _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    };
+    cost_sub = total(sum_sub);
+    cost_up = total(sum_up);
+    cost_paeth = total(sum_paeth);
+#else
+    for (size_t i = 0; i < n; i++) {
+        int a = x[i - 3], b = p[i], c = p[i - 3];
+        int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+        int predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+        sub[i] = (uint8_t) (x[i] - a);
+        up[i] = (uint8_t) (x[i] - b);
+        paeth[i] = (uint8_t) (x[i] - predicted);
+        cost_sub += (uint64_t) std::abs((int8_t) sub[i]);
+        cost_up += (uint64_t) std::abs((int8_t) up[i]);
+        cost_paeth += (uint64_t) std::abs((int8_t) paeth[i]);
+    }
+#endif
+    if (cost_up <= cost_sub && cost_up <= cost_paeth) {
+        best = up;
+        return 2;
+    }
+    if (cost_sub <= cost_paeth) {
+        best = sub;
+        return 1;
+    }
+    best = paeth;
+    return 4;
+}
+
+struct PngStrip {
+    std::vector<uint8_t> deflated;
+    uLong adler = 0;
+    size_t raw_bytes = 0;
+};
+
+// filter and deflate rows [first, last) on their own; only the last strip ends the deflate stream
+static void encode_png_strip(const Image &image, uint32_t first, uint32_t last, int level, PngStrip &strip) {
+    const size_t n = (size_t) image.width * 3;
+    const size_t padded = n + 2 * ROW_PADDING;
+    std::vector<uint8_t> rows(5 * padded, 0);
+    uint8_t *prev = rows.data() + ROW_PADDING;
+    uint8_t *cur = prev + padded;
+    uint8_t *sub = cur + padded, *up = sub + padded, *paeth = up + padded;
+    if (first > 0)
+        fetch_rgb_row(image, first - 1, prev);
+
+    std::vector<uint8_t> filtered((size_t) (last - first) * (n + 1));
+    uint8_t *dst = filtered.data();
+    for (uint32_t y = first; y < last; y++) {
+        fetch_rgb_row(image, y, cur);
+        const uint8_t *best;
+        *dst++ = filter_row(cur, prev, n, sub, up, paeth, best);
+        std::memcpy(dst, best, n);
+        dst += n;
+        std::swap(prev, cur);
+    }
+    strip.raw_bytes = filtered.size();
+    strip.adler = adler32(adler32(0L, Z_NULL, 0), filtered.data(), (uInt) filtered.size());
+
+    // raw deflate; a sync flush byte-aligns a strip that is not the last so the next one can follow it
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+    strip.deflated.resize(deflateBound(&zs, (uLong) filtered.size()) + 16);
+    zs.next_in = filtered.data();
+    zs.avail_in = (uInt) filtered.size();
+    zs.next_out = strip.deflated.data();
+    zs.avail_out = (uInt) strip.deflated.size();
+    deflate(&zs, last == image.height ? Z_FINISH : Z_SYNC_FLUSH);
+    strip.deflated.resize(zs.total_out);
+    deflateEnd(&zs);
+}
+
+static void put_png_chunk(std::vector<uint8_t> &out, const char *type, const uint8_t *data, size_t size) {
+    put_u32_be(out, (uint32_t) size);
+    out.insert(out.end(), type, type + 4);
+    uLong crc = crc32(crc32(0L, Z_NULL, 0), (const Bytef *) type, 4);
+    if (size > 0) {
+        out.insert(out.end(), data, data + size);
+        crc = crc32(crc, data, (uInt) size);
+    }
+    put_u32_be(out, (uint32_t) crc);
+}
+
+void encode_png(const Image &image, std::vector<uint8_t> &out, ThreadPool *pool, int level) {
+    const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    out.insert(out.end(), signature, signature + 8);
+
+    uint8_t ihdr[13] = {0};
+    for (int k = 0; k < 4; k++) {
+        ihdr[k] = (uint8_t) (image.width >> (24 - 8 * k));
+        ihdr[4 + k] = (uint8_t) (image.height >> (24 - 8 * k));
+    }
+    ihdr[8] = 8;  // bit depth
+    ihdr[9] = 2;  // truecolor RGB
+    put_png_chunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    const uint32_t strip_count = std::max<uint32_t>((image.height + PNG_STRIP_ROWS - 1) / PNG_STRIP_ROWS, 1);
+    std::vector<PngStrip> strips(strip_count);
+    auto encode_strips = [&](size_t begin, size_t end) {
+        for (size_t s = begin; s < end; s++)
+            encode_png_strip(image, (uint32_t) s * PNG_STRIP_ROWS,
+                             std::min(image.height, (uint32_t) (s + 1) * PNG_STRIP_ROWS), level, strips[s]);
+    };
+    if (pool != NULL)
+        pool->parallel_for(strip_count, 1, encode_strips);
+    else
+        encode_strips(0, strip_count);
+
+    // one zlib stream: header, the strips back to back and the adler32 of all the filtered bytes.
+    // the header's level bits are informational only and left at 0.
+    std::vector<uint8_t> idat = {0x78, 0x01};
+    uLong adler = adler32(0L, Z_NULL, 0);
+    for (const PngStrip &strip: strips) {
+        idat.insert(idat.end(), strip.deflated.begin(), strip.deflated.end());
+        adler = adler32_combine(adler, strip.adler, (z_off_t) strip.raw_bytes);
+    }
+    put_u32_be(idat, (uint32_t) adler);
+    put_png_chunk(out, "IDAT", idat.data(), idat.size());
+    put_png_chunk(out, "IEND", NULL, 0);
+}
+
+bool write_image(const std::string &path, const Image &image, ThreadPool *pool) {
+    std::vector<uint8_t> data;
+    switch (image_format_from_path(path)) {
+        case ImageFormat::PNG:
+            encode_png(image, data, pool);
+            break;
+        case ImageFormat::QOI:
+            encode_qoi(image, data);
+            break;
+        case ImageFormat::PPM:
+            encode_ppm(image, data);
+            break;
+    }
+
+    std::ofstream fout(path, std::ios::binary);
+    if (!fout.write((const char *) data.data(), (std::streamsize) data.size())) {
+        std::cout << "ERROR::IMAGE::FILE_NOT_WRITABLE: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,66 @@
+#include <image_writer.h>
+
+#include <algorithm>
+
+ImageWriter::ImageWriter(size_t encode_threads, size_t writer_threads, size_t queue_limit)
+        : pool(encode_threads), max_queued(queue_limit) {
+    for (size_t i = 0; i < std::max<size_t>(writer_threads, 1); i++)
+        workers.emplace_back(&ImageWriter::writer_loop, this);
+}
+
+ImageWriter::~ImageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker: workers)
+        worker.join();
+}
+
+void ImageWriter::submit(const std::string &path, Image image) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        space.wait(lock, [this] { return max_queued == 0 || jobs.size() < max_queued; });
+        jobs.push_back({path, std::move(image)});
+    }
+    wake.notify_one();
+}
+
+void ImageWriter::submit(const std::string &path, const uint8_t *pixels, uint32_t width, uint32_t height,
+                         uint32_t channels, bool bottom_up) {
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.channels = channels;
+    image.bottom_up = bottom_up;
+    // one straight copy, the vector is not zeroed first
+    image.pixels.assign(pixels, pixels + (size_t) width * height * channels);
+    submit(path, std::move(image));
+}
+
+void ImageWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return jobs.empty() && busy == 0; });
+}
+
+void ImageWriter::writer_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty())
+            break;  // stopping with nothing left to write
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        busy++;
+        lock.unlock();
+        space.notify_one();
+
+        write_image(job.path, job.image, &pool);
+
+        lock.lock();
+        busy--;
+        if (jobs.empty() && busy == 0)
+            idle.notify_all();
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include <scene_renderer.h>
+#include <sim_clock.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// an image sequence rendered at exact simulation instants, independent of wall time. every
+// tick of the list becomes one image named <prefix>_<index>.<format>, the index being its
+// position in the list, so the sequence sorts in list order however the work was spread.
+struct BatchSettings {
+    std::vector<SimTick> ticks;
+    std::string output_prefix = "frame";
+    std::string format = "png";
+    size_t workers = 0;  // 0 picks one per hardware thread
+    bool software = false;
+    uint32_t width = 1024;
+    uint32_t height = 768;
+    SceneCamera camera;
+    std::string shader_cache = DEFAULT_SHADER_CACHE;
+    // the scene of main.cpp: the solar system, or with nbody_count > 0 the n-body scene, whose
+    // positions then have to come from the ephemeris table since the integrator cannot seek
+    size_t nbody_count = 0;
+    std::string ephemeris_path;
+    std::string spk_path;
+};
+
+struct BatchReport {
+    size_t frames = 0;
+    size_t workers = 0;
+    double seconds = 0.0;
+    double frames_per_second = 0.0;
+};
+
+// "<first day>:<last day>:<step hours>", both ends included, appended to 'ticks'
+bool parse_batch_range(const std::string &spec, std::vector<SimTick> &ticks);
+
+// days separated by white space, appended to 'ticks'
+bool load_batch_times(const std::string &path, std::vector<SimTick> &ticks);
+
+// render every tick, sharded over worker threads that each own an offscreen context (or a
+// single-threaded software rasterizer), and wait until every image is on disk
+bool render_batch(const BatchSettings &settings, BatchReport &report);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef BODY_REGISTRY_H
+#define BODY_REGISTRY_H
+
+#include <glm/glm.hpp>
+#include <aligned_vector.h>
+#include <sim_clock.h>
+#include <fast_trig.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// parameters of a single body as handed to the registry
+struct BodyDesc {
+    int32_t parent = -1;        // body this one orbits, -1 when it sits at the origin
+    float orbit_radius = 0.0f;  // distance from the parent
+    float orbit_days = 0.0f;    // days per orbit around the parent, 0 for no orbit
+    float revolve_days = 0.0f;  // days per rotation around itself, 0 for no spin
+    float tilt_degrees = 0.0f;  // axial tilt, applied around the z axis
+    float scale = 1.0f;
+};
+
+// structure-of-arrays store of every body in the scene.
+// bodies must be added after their parent so a single forward pass resolves the hierarchy.
+class BodyRegistry {
+public:
+    int32_t add_body(const BodyDesc &desc);
+
+    void reserve(size_t count);
+
+    void clear();
+
+    size_t size() const { return parent.size(); }
+
+    // evaluate every body at the given instant and refresh the world matrices.
+    // the result depends on the tick alone, so seeking to the current tick again is free.
+    void seek(SimTick tick);
+
+    // same as seek, but bodies are placed at the given positions (one per body) instead of
+    // on their orbits, e.g. when an N-body integrator moves them. spin, tilt and scale still apply.
+    void seek(SimTick tick, const float *x, const float *y, const float *z);
+
+    // instant of the last seek, with either overload
+    SimTick evaluated_tick() const { return current_tick; }
+
+    // accuracy of the orbit and spin sine/cosine, Medium by default
+    void set_trig_accuracy(TrigAccuracy accuracy) {
+        trig_accuracy = accuracy;
+        evaluated = false;
+    }
+
+    const glm::mat4 *world_matrices() const { return world.data(); }
+
+    glm::vec3 world_position(int32_t body) const {
+        return {pos_x[body], pos_y[body], pos_z[body]};
+    }
+
+private:
+    void evaluate(SimTick tick, const float *given_x, const float *given_y, const float *given_z);
+
+    // body parameters
+    aligned_vector<int32_t> parent;
+    aligned_vector<float> orbit_radius;
+    aligned_vector<double> orbit_freq;  // turns per day
+    aligned_vector<double> spin_freq;   // turns per day
+    aligned_vector<float> tilt_cos;
+    aligned_vector<float> tilt_sin;
+    aligned_vector<float> scale;
+
+    // per-frame output
+    aligned_vector<float> pos_x;
+    aligned_vector<float> pos_y;
+    aligned_vector<float> pos_z;
+    aligned_vector<glm::mat4> world;
+
+    // per-frame scratch, angles are turned into their sine and cosine in place
+    aligned_vector<float> orbit_sin, orbit_cos;
+    aligned_vector<float> spin_sin, spin_cos;
+
+    TrigAccuracy trig_accuracy = TrigAccuracy::Medium;
+    SimTick current_tick = 0;
+    bool evaluated = false;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// a file of the source tree compiled into the executable (see tools/embed_assets.cmake), found
+// under its path relative to the tree, e.g. "shaders/shader.vs"
+struct EmbeddedAsset {
+    const char *path;
+    const char *data;
+    size_t size;
+    uint64_t hash;  // 64-bit FNV-1a of the contents
+};
+
+constexpr uint64_t embedded_asset_hash(const char *data, size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+        hash = (hash ^ (uint8_t) data[i]) * 1099511628211ull;
+    return hash;
+}
+
+// the generated table of every embedded file
+const EmbeddedAsset *embedded_assets(size_t &count);
+
+// the embedded file at 'path', NULL if it was not embedded
+const EmbeddedAsset *find_embedded_asset(const std::string &path);
+
+// development override: read assets from files under 'directory' (e.g. the source tree) instead
+// of the embedded copies, so edits show up without rebuilding; empty goes back to the embedded ones
+void set_asset_directory(const std::string &directory);
+
+// the file load_asset reads 'path' from, empty when the embedded copy is used
+std::string asset_file(const std::string &path);
+
+// contents of the asset at 'path': from the override directory if one is set, otherwise the
+// embedded copy, otherwise the file at 'path' itself
+bool load_asset(const std::string &path, std::string &data);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef EPHEMERIS_H
+#define EPHEMERIS_H
+
+#include <sim_clock.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// writes the position of every body at 'tick' into x, y and z
+typedef std::function<void(SimTick tick, float *x, float *y, float *z)> EphemerisSampler;
+
+// per-body settings for fitting an ephemeris
+struct EphemerisFit {
+    SimTick segment_ticks = SIM_TICKS_PER_DAY * 4;  // length of one polynomial segment
+    uint32_t max_coefficients = 12;                 // chebyshev terms per axis before trimming
+    float tolerance = 1.0e-4f;                      // largest position error trimming may add
+};
+
+// precomputed body positions stored as chebyshev polynomial segments, JPL DE style.
+// every body has its own segment length and term count; looking up a position is one
+// integer division to find the segment plus a Clenshaw recurrence per axis.
+class EphemerisTable {
+public:
+    // sample 'body_count' bodies over [start, end) and fit one polynomial per segment and axis.
+    // sample ticks are visited in increasing order, so a forward-only integrator can serve them.
+    static EphemerisTable fit(const EphemerisSampler &sample, size_t body_count,
+                              SimTick start, SimTick end, const std::vector<EphemerisFit> &fits);
+
+    // each body's segment length for fit over [start, end): doubling from its fits[b].segment_ticks
+    // up to max_segment_ticks, the length storing the fewest coefficients per tick among those whose
+    // fit converges, i.e. drops at least its last four terms under the tolerance. a pass of its own
+    // over the span, sampled in increasing tick order like fit, that only keeps one segment per
+    // candidate in memory; the sampler has to give the same positions again to fit.
+    static std::vector<EphemerisFit> choose_segments(const EphemerisSampler &sample, size_t body_count,
+                                                     SimTick start, SimTick end, SimTick max_segment_ticks,
+                                                     const std::vector<EphemerisFit> &fits);
+
+    bool save(const std::string &path) const;
+
+    bool load(const std::string &path);
+
+    size_t body_count() const { return tracks.size(); }
+
+    SimTick start_tick() const { return start; }
+
+    SimTick end_tick() const;
+
+    size_t byte_size() const;
+
+    SimTick segment_ticks(size_t body) const { return tracks[body].segment_ticks; }
+
+    uint32_t coefficient_count(size_t body) const { return tracks[body].coefficient_count; }
+
+    // ticks outside the fitted span are clamped to the first or last segment
+    glm::vec3 position(size_t body, SimTick tick) const;
+
+    void evaluate(SimTick tick, float *x, float *y, float *z) const;
+
+private:
+    struct Track {
+        SimTick segment_ticks;
+        uint32_t segment_count;
+        uint32_t coefficient_count;
+        uint64_t offset;  // first coefficient of the body in 'coefficients'
+    };
+
+    // coefficients of each body are laid out segment by segment, then axis by axis
+    const float *segment(size_t body, SimTick tick, float &tau) const;
+
+    SimTick start = 0;
+    std::vector<Track> tracks;
+    std::vector<float> coefficients;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef FAST_TRIG_H
+#define FAST_TRIG_H
+
+#include <simd_float.h>
+
+#include <cstddef>
+
+// accuracy tiers for sine/cosine. errors are absolute, measured by bench_trig against double
+// precision over |x| <= 1000; one float ULP just below 1.0 is 6e-8.
+enum class TrigAccuracy {
+    Fast,    // one-step range reduction, degree 5/4 polynomials: 1.4e-5 within a turn, 6e-5 at |x| = 1000
+    Medium,  // three-step range reduction, degree 7/8 polynomials: under 2 ULP (1e-7)
+    Exact    // std::sin/std::cos evaluated in double and rounded: half an ULP
+};
+
+// sine and cosine together. the argument is reduced to [-pi/4, pi/4] with a three-part
+// pi/2 (Cody-Waite) and fed to minimax polynomials; accuracy degrades slowly past |x| = 8192.
+inline void v_sincos(vfloat x, vfloat &s, vfloat &c) {
+    vint quadrant = v_round_int(x * v_set1(0.636619772367581343f));
+    vfloat j = v_to_float(quadrant);
+    vfloat r = v_fmadd(j, v_set1(-1.5703125f), x);
+    r = v_fmadd(j, v_set1(-4.837512969970703125e-4f), r);
+    r = v_fmadd(j, v_set1(-7.54978995489188216e-8f), r);
+    vfloat r2 = r * r;
+
+    vfloat ps = v_fmadd(r2, v_set1(-1.9515295891e-4f), v_set1(8.3321608736e-3f));
+    ps = v_fmadd(ps, r2, v_set1(-1.6666654611e-1f));
+    ps = v_fmadd(ps * r2, r, r);
+
+    vfloat pc = v_fmadd(r2, v_set1(2.443315711809948e-5f), v_set1(-1.388731625493765e-3f));
+    pc = v_fmadd(pc, r2, v_set1(4.166664568298827e-2f));
+    pc = v_fmadd(pc * r2, r2, v_fmadd(r2, v_set1(-0.5f), v_set1(1.0f)));
+
+    // odd quadrants swap the two polynomials, the sign follows the quadrant
+    vmask swap = v_int_test(quadrant, 1);
+    s = v_negate_if(v_int_test(quadrant, 2), v_select(swap, pc, ps));
+    c = v_negate_if(v_int_test(v_int_add(quadrant, 1), 2), v_select(swap, ps, pc));
+}
+
+// cheaper sine and cosine for angles that only feed rendering: a single-constant reduction
+// and shorter minimax polynomials (relative error fitted over [-pi/4, pi/4])
+inline void v_sincos_fast(vfloat x, vfloat &s, vfloat &c) {
+    vint quadrant = v_round_int(x * v_set1(0.636619772367581343f));
+    vfloat r = v_fmadd(v_to_float(quadrant), v_set1(-1.57079632679489662f), x);
+    vfloat r2 = r * r;
+
+    vfloat ps = v_fmadd(r2, v_set1(8.163348639518524e-3f), v_set1(-1.6663392974356392e-1f));
+    ps = v_fmadd(ps * r2, r, r);
+    vfloat pc = v_fmadd(r2, v_set1(4.045893791197486e-2f), v_set1(-4.9976075279369364e-1f));
+    pc = v_fmadd(pc, r2, v_set1(1.0f));
+
+    vmask swap = v_int_test(quadrant, 1);
+    s = v_negate_if(v_int_test(quadrant, 2), v_select(swap, pc, ps));
+    c = v_negate_if(v_int_test(v_int_add(quadrant, 1), 2), v_select(swap, ps, pc));
+}
+
+// s[i] = sin(angles[i]) and c[i] = cos(angles[i]) for count angles in radians.
+// the arrays need no particular alignment; s or c may alias angles.
+void sincos_array(const float *angles, float *s, float *c, size_t count,
+                  TrigAccuracy accuracy = TrigAccuracy::Medium);
+
+#endif
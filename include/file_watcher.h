@@ -0,0 +1,40 @@
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// notices when any of a set of files is written, e.g. shader sources being edited. on Linux,
+// inotify watches the directories holding them, since editors often save by renaming a new file
+// over the old one; elsewhere modification times are compared on every poll.
+class FileWatcher {
+public:
+    FileWatcher();
+
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher &) = delete;
+
+    FileWatcher &operator=(const FileWatcher &) = delete;
+
+    // add 'path' to the watched files; watching one twice is harmless
+    bool watch(const std::string &path);
+
+    // true if a watched file changed since the last call; never blocks
+    bool poll();
+
+private:
+    struct WatchedFile {
+        std::string path;
+        std::filesystem::path directory;
+        std::string name;
+        std::filesystem::file_time_type modified;
+        int watch_descriptor;
+    };
+
+    std::vector<WatchedFile> files;
+    int inotify_fd = -1;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <cstddef>
+
+// intervals between presented frames since the last reset
+struct FramePacingStats {
+    size_t frames = 0;
+    double mean_ms = 0.0;
+    double jitter_ms = 0.0;  // standard deviation of the interval
+    double min_ms = 0.0;
+    double max_ms = 0.0;
+    size_t missed = 0;       // intervals longer than one and a half frames
+};
+
+// holds the main loop to a frame rate without spinning a core: it sleeps until shortly before
+// each deadline and spins only for the last stretch, where the OS sleep is too coarse
+class FramePacer {
+public:
+    explicit FramePacer(double frames_per_second = 60.0);
+
+    void set_rate(double frames_per_second);
+
+    double rate() const { return 1.0 / period.count(); }
+
+    // block until the next frame is due. a loop that fell more than a frame behind starts over
+    // from now instead of rushing out the frames it missed.
+    void wait();
+
+    // record that a frame reached the screen, for the pacing statistics
+    void frame_presented() { frame_presented(std::chrono::steady_clock::now()); }
+
+    // the same for a frame presented at 'when' by another thread, reported in presentation order
+    void frame_presented(std::chrono::steady_clock::time_point when);
+
+    FramePacingStats stats() const;
+
+    void reset_stats();
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    std::chrono::duration<double> period;
+    Clock::time_point deadline;
+    bool started = false;
+
+    Clock::time_point last_present;
+    bool presented = false;
+    size_t intervals = 0;
+    size_t missed = 0;
+    double sum = 0.0, sum_squares = 0.0, shortest = 0.0, longest = 0.0;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef FRAME_PACKET_H
+#define FRAME_PACKET_H
+
+#include <glm/glm.hpp>
+#include <body_registry.h>
+#include <render_queue.h>
+#include <thread_pool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// where the scene is seen from; the camera always aims at the focus body
+struct SceneCamera {
+    glm::vec3 eye = glm::vec3(100.0f, 50.0f, 100.0f);
+    float fov_degrees = 30.0f;
+    float near_plane = 0.1f;
+    float far_plane = 1000.0f;
+};
+
+// what the per-instance matrix stream holds
+enum class InstanceTransform {
+    Model,               // world matrices as they leave the registry; the vertex shader applies the frame's view-projection
+    ModelViewProjection  // view-projection applied on the CPU, leaving one matrix-vector product per vertex
+};
+
+// bodies per chunk recorded by one task, and drawn by one command
+const size_t RECORD_CHUNK_BODIES = 4096;
+
+// mesh indices of the sort keys, resolved to GL names by the renderer
+const uint32_t MESH_CUBE = 0;
+
+// one frame of the scene, recorded without touching GL: the camera, the instance matrices and a
+// command per chunk of bodies. once recorded it no longer refers to the registry, so the thread
+// owning the context can draw it while the next frame is simulated.
+struct FramePacket {
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 eye = glm::vec3(0.0f);
+    float time = 0.0f;  // simulation days
+    InstanceTransform transform = InstanceTransform::Model;
+    // a range per chunk, front to back within it
+    std::vector<glm::mat4> instances;
+    // in chunk order, unsorted; the key's mesh index and the instance range are set, the GL names
+    // are left to the renderer
+    std::vector<DrawCommand> commands;
+    // per chunk: view distance bits << 32 | body index, and radix sort scratch
+    std::vector<std::vector<uint64_t>> chunk_order, chunk_scratch;
+};
+
+// record the bodies as seen from 'camera' aiming at 'focus' into 'packet', reusing its storage.
+// with a pool the chunks are recorded in parallel, each writing only its own range.
+void record_frame(const BodyRegistry &bodies, int32_t focus, const SceneCamera &camera, float aspect,
+                  InstanceTransform transform, FramePacket &packet, ThreadPool *pool = NULL,
+                  size_t chunk_bodies = RECORD_CHUNK_BODIES);
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// calls reaching the driver and calls dropped because they would not have changed anything
+struct GLStateStats {
+    uint64_t issued = 0;
+    uint64_t filtered = 0;
+};
+
+// a shadow copy of the GL state the renderer touches every frame, so binds and state changes
+// that would leave it as it is never reach the driver. state starts unknown and is learned from
+// the first call setting it; code changing the same state behind the cache's back has to call
+// invalidate() afterwards. one per context, used on the thread the context is current on.
+class GLStateCache {
+public:
+    static const size_t TEXTURE_UNITS = 16;
+    static const size_t UNIFORM_BUFFER_BINDINGS = 16;
+
+    GLStateCache() { invalidate(); }
+
+    void use_program(GLuint program);
+
+    void bind_vertex_array(GLuint vertex_array);
+
+    // array, uniform, pixel pack/unpack and copy buffers are tracked; other targets always go through
+    void bind_buffer(GLenum target, GLuint buffer);
+
+    // indexed uniform buffer binding, which also sets the generic GL_UNIFORM_BUFFER binding
+    void bind_buffer_base(GLenum target, GLuint index, GLuint buffer);
+
+    // makes 'unit' the active texture unit; 2D textures are tracked
+    void bind_texture(GLuint unit, GLenum target, GLuint texture);
+
+    // depth test, blending and face culling are tracked; other capabilities always go through
+    void set_enabled(GLenum capability, bool enabled);
+
+    void depth_func(GLenum func);
+
+    void blend_func(GLenum source, GLenum destination);
+
+    void cull_face(GLenum mode);
+
+    void viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+    // forget everything, e.g. after other code changed state directly
+    void invalidate();
+
+    // compare every known value against glGet after each call and report differences; slow,
+    // meant for finding code that changes state without telling the cache
+    void set_verify(bool enabled) { verify_calls = enabled; }
+
+    // report every known value that differs from glGet, true if none does
+    bool verify() const;
+
+    // the counters of the frame just finished, starting over for the next one
+    GLStateStats end_frame();
+
+    const GLStateStats &frame_stats() const { return stats; }
+
+private:
+    static const GLuint UNKNOWN = 0xFFFFFFFFu;
+
+    enum BufferSlot {
+        ARRAY_BUFFER, UNIFORM_BUFFER, PIXEL_PACK_BUFFER, PIXEL_UNPACK_BUFFER, COPY_READ_BUFFER, COPY_WRITE_BUFFER,
+        BUFFER_SLOTS
+    };
+
+    enum CapabilitySlot {
+        DEPTH_TEST, BLEND, CULL_FACE, CAPABILITY_SLOTS
+    };
+
+    static int buffer_slot(GLenum target);
+
+    static int capability_slot(GLenum capability);
+
+    // count a call as issued when it changes something, as filtered otherwise
+    bool record(bool changes);
+
+    // with verification on, compare the shadow state after a call
+    void check() const;
+
+    void active_texture(GLuint unit);
+
+    GLuint program, vertex_array;
+    GLuint buffers[BUFFER_SLOTS];
+    GLuint uniform_buffers[UNIFORM_BUFFER_BINDINGS];
+    GLuint active_unit;
+    GLuint textures_2d[TEXTURE_UNITS];
+    GLuint capabilities[CAPABILITY_SLOTS];  // 0, 1 or UNKNOWN
+    GLuint depth_function, blend_source, blend_destination, cull_mode;
+    GLint viewport_box[4];
+    bool viewport_known;
+
+    bool verify_calls = false;
+    GLStateStats stats;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// an OpenGL 3.3 core context without a window or display server: EGL on Mesa's surfaceless
+// platform (llvmpipe on machines without a GPU), falling back to the default EGL display.
+// everything is drawn into a framebuffer object of its own, which stays bound for drawing and
+// reading, so the capture path reads it like a window's back buffer.
+// each thread may own a context of its own. only available when built with EGL; create()
+// reports an error otherwise.
+class HeadlessContext {
+public:
+    HeadlessContext() = default;
+
+    ~HeadlessContext();
+
+    HeadlessContext(const HeadlessContext &) = delete;
+
+    HeadlessContext &operator=(const HeadlessContext &) = delete;
+
+    // create the context, make it current, load the GL functions and set up the framebuffer
+    bool create(uint32_t width, uint32_t height);
+
+    void destroy();
+
+    bool is_created() const { return context != nullptr; }
+
+    GLuint framebuffer() const { return fbo; }
+
+private:
+    // destroy with the display lock held
+    void release();
+
+    void *display = nullptr;  // EGLDisplay
+    void *context = nullptr;  // EGLContext
+    GLuint fbo = 0, color = 0, depth = 0;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <thread_pool.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 8-bit pixels, rows packed without padding
+struct Image {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t channels = 3;   // 3 for RGB, 4 for RGBA; alpha is dropped when encoding
+    bool bottom_up = false;  // rows stored last to first, as glReadPixels returns them
+    std::vector<uint8_t> pixels;
+};
+
+enum class ImageFormat {
+    PPM,  // binary P6, no compression
+    QOI,  // "quite OK image" format: one fast serial pass, typically 5-10x smaller for rendered frames
+    PNG   // deflate over filtered rows, strips compressed in parallel
+};
+
+// picked by file extension (.png, .qoi), anything else is PPM
+ImageFormat image_format_from_path(const std::string &path);
+
+// encoders append the complete file to 'out'. all of them write RGB.
+void encode_ppm(const Image &image, std::vector<uint8_t> &out);
+
+void encode_qoi(const Image &image, std::vector<uint8_t> &out);
+
+// rows are filtered per row with the cheapest of Sub, Up and Paeth, then deflated in horizontal
+// strips that are compressed independently and stitched into one zlib stream. with a pool the
+// strips are compressed in parallel; 'level' is the zlib level.
+void encode_png(const Image &image, std::vector<uint8_t> &out, ThreadPool *pool = NULL, int level = 2);
+
+// encode in the format the extension asks for and write the file in one go
+bool write_image(const std::string &path, const Image &image, ThreadPool *pool = NULL);
+
+#endif
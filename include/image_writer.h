@@ -0,0 +1,59 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <image_encoder.h>
+#include <thread_pool.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// encodes and writes images on threads of its own so the caller never waits on the disk.
+// the format follows each path's extension; PNG strips are spread over a pool of encode threads.
+class ImageWriter {
+public:
+    // 0 encode threads picks one per hardware thread. several writer threads encode several
+    // images at once, for producers that outpace a single one. with a queue limit, submit
+    // waits while that many images are queued, bounding the memory they hold.
+    explicit ImageWriter(size_t encode_threads = 0, size_t writer_threads = 1, size_t queue_limit = 0);
+
+    // writes everything still queued before returning
+    ~ImageWriter();
+
+    ImageWriter(const ImageWriter &) = delete;
+
+    ImageWriter &operator=(const ImageWriter &) = delete;
+
+    void submit(const std::string &path, Image image);
+
+    // copies the pixels, so they only need to live through the call
+    void submit(const std::string &path, const uint8_t *pixels, uint32_t width, uint32_t height,
+                uint32_t channels, bool bottom_up);
+
+    // block until every submitted image is on disk
+    void flush();
+
+private:
+    struct Job {
+        std::string path;
+        Image image;
+    };
+
+    void writer_loop();
+
+    ThreadPool pool;
+    std::deque<Job> jobs;
+    std::mutex mutex;
+    std::condition_variable wake, idle, space;
+    size_t busy = 0;
+    size_t max_queued = 0;
+    bool stopping = false;
+    // last, so everything the threads touch exists before they start
+    std::vector<std::thread> workers;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef KEPLER_H
+#define KEPLER_H
+
+#include <aligned_vector.h>
+#include <sim_clock.h>
+
+#include <cstddef>
+
+// classical elements of one bound orbit, angles in radians.
+// the reference plane is the scene's x-z plane with y up, the same frame BodyRegistry orbits in.
+struct OrbitalElements {
+    float a = 1.0f;     // semi-major axis
+    float e = 0.0f;     // eccentricity, 0 <= e < 1
+    float i = 0.0f;     // inclination
+    float raan = 0.0f;  // longitude of the ascending node
+    float argp = 0.0f;  // argument of periapsis
+    float m0 = 0.0f;    // mean anomaly at tick 0
+};
+
+// Keplerian two-body propagator for many orbits around one central mass.
+// orbits are kept as aligned structure-of-arrays columns padded to the SIMD width, and
+// Kepler's equation is solved for a whole vector of bodies per Newton step.
+class KeplerOrbits {
+public:
+    // gravitational parameter of the central body in scene units^3 / day^2
+    explicit KeplerOrbits(double mu) : mu(mu) {}
+
+    size_t add_orbit(const OrbitalElements &el);
+
+    // convert position/velocity pairs observed at 'epoch' into orbits and append them.
+    // velocities are in scene units per day; unbound states (e >= 1) are skipped.
+    // returns the number of orbits added.
+    size_t add_states(SimTick epoch, size_t count,
+                      const float *x, const float *y, const float *z,
+                      const float *vx, const float *vy, const float *vz);
+
+    OrbitalElements elements(size_t orbit) const;
+
+    void reserve(size_t count);
+
+    void clear();
+
+    size_t size() const { return count; }
+
+    // positions of every orbit at 'tick', written to arrays of at least size() floats
+    void propagate(SimTick tick, float *x, float *y, float *z);
+
+    // positions and velocities (scene units per day) of every orbit at 'tick'
+    void propagate(SimTick tick, float *x, float *y, float *z, float *vx, float *vy, float *vz);
+
+private:
+    template<bool with_velocity>
+    void propagate_columns(SimTick tick, float *x, float *y, float *z, float *vx, float *vy, float *vz);
+
+    void resize_columns(size_t padded);
+
+    double mu;
+    size_t count = 0;
+
+    // elements as given
+    aligned_vector<float> inclination;
+    aligned_vector<float> raan;
+    aligned_vector<float> argp;
+    aligned_vector<float> m0;
+
+    // derived per-orbit constants used by the solver
+    aligned_vector<double> turns_per_day;
+    aligned_vector<float> mean_motion;    // radians per day
+    aligned_vector<float> semi_major;
+    aligned_vector<float> semi_minor;
+    aligned_vector<float> eccentricity;
+    aligned_vector<float> p_x, p_y, p_z;  // unit vector towards periapsis
+    aligned_vector<float> q_x, q_y, q_z;  // unit vector 90 degrees ahead of it in the orbit plane
+
+    // scratch column of reduced mean anomalies
+    aligned_vector<float> mean_anomaly;
+};
+
+#endif
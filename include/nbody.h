@@ -0,0 +1,92 @@
+#ifndef NBODY_H
+#define NBODY_H
+
+#include <aligned_vector.h>
+#include <thread_pool.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// gravitational N-body integrator. forces come from a Barnes-Hut octree rebuilt every step
+// and are evaluated in parallel; bodies advance with kick-drift-kick leapfrog (velocity Verlet).
+// distances are scene units, time is days and each body's mass is given as its
+// gravitational parameter (G * m) in scene units^3 / day^2.
+class NBodySystem {
+public:
+    // 0 threads picks one per hardware thread. the threads start with the first step, so a
+    // system that is only built and never stepped costs none
+    explicit NBodySystem(size_t threads = 0);
+
+    size_t add_body(const glm::vec3 &pos, const glm::vec3 &vel, float mu);
+
+    void reserve(size_t count);
+
+    size_t size() const { return mu.size(); }
+
+    // opening angle: a cell is treated as a point mass when size / distance < theta. cells
+    // overlapping the leaf being summed are always opened, so any value is safe from bodies
+    // pulling on themselves; 0 sums every pair, above about 1 the error grows quickly
+    void set_theta(float value) { theta = std::max(value, 0.0f); }
+
+    // Plummer softening length, keeps close encounters from blowing up
+    void set_softening(float value) { softening = value; }
+
+    // advance every body by dt days
+    void step(float dt);
+
+    // positions in the order bodies were added
+    void copy_positions(float *x, float *y, float *z) const;
+
+    glm::vec3 position(size_t body) const;
+
+    size_t tree_node_count() const { return nodes.size(); }
+
+private:
+    struct Node {
+        float center_x, center_y, center_z, half;  // cube covered by the cell
+        float com_x, com_y, com_z, mu;             // centre of mass and total mass of the cell
+        int32_t first_child;                       // -1 for a leaf
+        int32_t child_count;
+        int32_t begin, end;                        // slots of the bodies in the cell
+    };
+
+    void build_tree();
+
+    void fill_node(int32_t index, int level, float cx, float cy, float cz, float half);
+
+    void compute_accelerations();
+
+    void kick(float dt);
+
+    void drift(float dt);
+
+    ThreadPool &workers();
+
+    size_t pool_threads;
+    std::unique_ptr<ThreadPool> pool;
+    float theta = 0.5f;
+    float softening = 0.01f;
+    bool accelerations_valid = false;
+
+    // bodies are kept sorted along a Morton curve so tree cells map to contiguous ranges
+    aligned_vector<float> pos_x, pos_y, pos_z;
+    aligned_vector<float> vel_x, vel_y, vel_z;
+    aligned_vector<float> acc_x, acc_y, acc_z;
+    aligned_vector<float> mu;
+    std::vector<uint32_t> id;    // original index of the body stored in each slot
+    std::vector<uint32_t> slot;  // slot currently holding each original body
+
+    std::vector<uint64_t> keys, keys_scratch;
+    std::vector<uint32_t> order, order_scratch;
+    aligned_vector<float> float_scratch;
+    std::vector<uint32_t> id_scratch;
+    std::vector<Node> nodes;
+    std::vector<int32_t> leaves;
+};
+
+#endif
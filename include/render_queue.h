@@ -0,0 +1,87 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <gl_state_cache.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// LSD radix sort of 'items' by a 64-bit key, 8 bits per pass. passes over a byte that every key
+// shares are skipped, so keys with few distinct bits cost few passes. stable; 'scratch' is resized.
+template<typename T, typename KeyOf>
+void radix_sort(std::vector<T> &items, std::vector<T> &scratch, KeyOf key_of) {
+    scratch.resize(items.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const T &item: items)
+            counts[(key_of(item) >> shift) & 0xFF]++;
+        if (items.empty() || counts[(key_of(items[0]) >> shift) & 0xFF] == items.size())
+            continue;
+        size_t offset = 0;
+        for (size_t &count: counts) {
+            size_t next = offset + count;
+            count = offset;
+            offset = next;
+        }
+        for (const T &item: items)
+            scratch[counts[(key_of(item) >> shift) & 0xFF]++] = item;
+        items.swap(scratch);
+    }
+}
+
+// bits of a draw's sort key, most significant first: whatever changes least often goes on top, so
+// draws sharing a program, mesh and material end up next to each other, and among those the
+// nearest is drawn first for early depth rejection
+const int SORT_KEY_LAYER_BITS = 4;      // opaque before anything blended
+const int SORT_KEY_PROGRAM_BITS = 12;
+const int SORT_KEY_MESH_BITS = 12;
+const int SORT_KEY_MATERIAL_BITS = 12;
+const int SORT_KEY_DEPTH_BITS = 24;
+
+const uint32_t RENDER_LAYER_OPAQUE = 0;
+
+// 'program', 'mesh' and 'material' are small indices handed out by the caller, not GL names;
+// 'depth' is the view distance over the far plane, clamped to [0, 1]
+uint64_t make_sort_key(uint32_t layer, uint32_t program, uint32_t mesh, uint32_t material, float depth);
+
+// a triangle list drawn once per instance of a range of a per-instance matrix buffer
+struct DrawCommand {
+    uint64_t key = 0;
+    GLuint program = 0;
+    GLuint vertex_array = 0;
+    GLsizei vertex_count = 0;
+    GLuint instance_buffer = 0;    // holds one mat4 per instance; 0 when the mesh has none
+    GLuint instance_location = 0;  // the matrix's first attribute location, one per column
+    uint32_t first_instance = 0;
+    uint32_t instance_count = 1;
+};
+
+// the draws of one frame: submitted in any order, sorted by key, then issued in one loop
+class RenderQueue {
+public:
+    void clear() { commands.clear(); }
+
+    void submit(const DrawCommand &command) { commands.push_back(command); }
+
+    void sort();
+
+    // issue every command in order, binding through 'state'. GL 3.3 has no base instance, so an
+    // instance range is selected by pointing the matrix attributes at its first element.
+    void execute(GLStateCache &state);
+
+    // forget where instance attributes point, e.g. after a vertex array was set up again
+    void invalidate() { instance_offsets.clear(); }
+
+    size_t size() const { return commands.size(); }
+
+    const std::vector<DrawCommand> &sorted() const { return commands; }
+
+private:
+    std::vector<DrawCommand> commands, scratch;
+    std::unordered_map<GLuint, uint32_t> instance_offsets;  // vertex array -> first instance its attributes point at
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <frame_packet.h>
+#include <gl_state_cache.h>
+#include <scene_renderer.h>
+#include <screen_capture.h>
+#include <spsc_queue.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <thread>
+#include <vector>
+
+// frames recorded ahead of the one being drawn; more of them only add latency
+const size_t RENDER_FRAMES_IN_FLIGHT = 2;
+
+// one frame on its way from the simulation to the screen
+struct RenderFrame {
+    FramePacket packet;
+    bool screenshot = false;
+    int viewport_width = 0, viewport_height = 0;  // resize the viewport before drawing; 0 keeps it
+    // set when the frame comes back: the state cache counters of the last complete frame, and
+    // when the frame was presented, if the context presents
+    GLStateStats gl_stats;
+    bool presented = false;
+    std::chrono::steady_clock::time_point presented_at;
+};
+
+// how the render thread gets at its context. attach makes it current on the calling thread, or
+// creates it there; detach lets go of it, present shows the frame just drawn. any may be empty.
+struct RenderContext {
+    std::function<bool()> attach;
+    std::function<void()> detach;
+    std::function<void()> present;
+};
+
+// what to do with each frame once drawn, before it is presented, e.g. capture it; runs on the render thread
+typedef std::function<void(SceneRenderer &renderer, ScreenCapture &capture, const RenderFrame &frame)> FrameOutput;
+
+// a thread owning the GL context and the renderer, drawing frames recorded on other threads.
+// frames go round between the two sides through a pair of lock-free single producer, single
+// consumer queues: acquire a drawn one, record into it, submit it. only one thread may acquire
+// and submit.
+class RenderThread {
+public:
+    RenderThread();
+
+    ~RenderThread();
+
+    RenderThread(const RenderThread &) = delete;
+
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    // start the thread, attach the context and init 'renderer' on it with the given arguments;
+    // false when either fails. the renderer is only to be touched by the render thread until stop().
+    bool start(SceneRenderer &renderer, bool software, uint32_t width, uint32_t height, const RenderContext &context,
+               const FrameOutput &output);
+
+    // a frame to record into, waiting for the render thread to hand one back
+    RenderFrame *acquire();
+
+    // queue a frame from acquire() for drawing
+    void submit(RenderFrame *frame);
+
+    // draw whatever was submitted, release the renderer and the context, and join the thread
+    void stop();
+
+private:
+    void run(SceneRenderer &renderer, bool software, uint32_t width, uint32_t height, std::promise<bool> &started);
+
+    std::vector<RenderFrame> frames;
+    SpscQueue<RenderFrame *> filled, drawn;  // to the render thread and back
+    std::atomic<bool> stopping{false};
+    RenderContext context;
+    FrameOutput output;
+    std::thread thread;
+};
+
+#endif
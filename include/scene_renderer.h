@@ -0,0 +1,124 @@
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include <glm/glm.hpp>
+#include <body_registry.h>
+#include <file_watcher.h>
+#include <frame_packet.h>
+#include <gl_state_cache.h>
+#include <render_queue.h>
+#include <screen_capture.h>
+#include <shader.h>
+#include <soft_rasterizer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// where linked programs are kept between runs, relative to the working directory
+const char *const DEFAULT_SHADER_CACHE = "shader_cache";
+
+// binding point of the FrameUniforms block, the same for every program
+const GLuint FRAME_UNIFORM_BINDING = 0;
+
+// std140 layout of the FrameUniforms block, rewritten once per frame
+struct FrameUniforms {
+    glm::mat4 view_projection;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec4 camera_position;  // w is 1
+    float time;                 // simulation days
+    float padding[3];
+};
+
+// the scene: one colored cube per body of the registry, drawn through OpenGL (an instanced draw
+// call per recorded chunk) or the software rasterizer. with GL, the context has to be current on the calling
+// thread for every call.
+class SceneRenderer {
+public:
+    SceneRenderer() = default;
+
+    ~SceneRenderer();
+
+    SceneRenderer(const SceneRenderer &) = delete;
+
+    SceneRenderer &operator=(const SceneRenderer &) = delete;
+
+    // raster_threads only applies to the software rasterizer, 0 picks one per hardware thread;
+    // the instance transform only to GL
+    bool init(bool software, uint32_t width, uint32_t height, size_t raster_threads = 0,
+              InstanceTransform transform = InstanceTransform::ModelViewProjection);
+
+    // delete the GL objects; call it before tearing the context down
+    void release();
+
+    void set_camera(const SceneCamera &scene_camera) { camera = scene_camera; }
+
+    const SceneCamera &get_camera() const { return camera; }
+
+    // directory of the program binary cache, empty to always compile; takes effect at init
+    void set_shader_cache(const std::string &directory) { shader_cache = directory; }
+
+    // watch the shader sources read from disk (see set_asset_directory) and swap in rebuilt
+    // programs when they are edited; takes effect at init
+    void set_hot_reload(bool enabled) { hot_reload = enabled; }
+
+    // clear the frame and draw every body, looking at 'focus'
+    void draw(const BodyRegistry &bodies, int32_t focus);
+
+    // clear the frame and draw a packet recorded with record_frame, on any thread, for this
+    // renderer's aspect() and packet_transform()
+    void draw(const FramePacket &packet);
+
+    float aspect() const { return (float) frame_width / (float) frame_height; }
+
+    // the instance transform packets have to be recorded with
+    InstanceTransform packet_transform() const {
+        return software_raster ? InstanceTransform::Model : instance_transform;
+    }
+
+    // hand the frame just drawn to 'sink'. the software rasterizer's frame goes right away; GL
+    // frames are queued on 'capture', with the same meaning of 'wait_when_full' and the result.
+    bool capture(ScreenCapture &capture, const CaptureSink &sink, bool wait_when_full = false);
+
+    bool is_software() const { return software_raster != nullptr; }
+
+    uint32_t width() const { return frame_width; }
+
+    uint32_t height() const { return frame_height; }
+
+    // the GL state shadow of this renderer's context, e.g. to turn on verification; code drawing
+    // into the same context between frames has to invalidate() it if it changes tracked state
+    GLStateCache &gl_state_cache() { return gl_state; }
+
+    // calls issued and filtered by the state cache during the last complete frame
+    const GLStateStats &gl_frame_stats() const { return last_frame_gl; }
+
+private:
+    // point 'shader' at the variant in use and its FrameUniforms block at the binding point
+    void select_program();
+
+    void watch_shader_sources();
+
+    SceneCamera camera;
+    std::string shader_cache = DEFAULT_SHADER_CACHE;
+    uint32_t frame_width = 0, frame_height = 0;
+    std::unique_ptr<SoftRasterizer> software_raster;
+    std::unique_ptr<ShaderVariants> shaders;
+    Shader *shader = nullptr;  // the variant in use, owned by 'shaders'
+    ShaderDefines shader_defines;
+    bool hot_reload = false;
+    std::unique_ptr<FileWatcher> shader_watcher;
+    InstanceTransform instance_transform = InstanceTransform::Model;
+    uint32_t VBO = 0, VAO = 0;
+    uint32_t instance_VBO = 0;  // one matrix per body, rewritten every frame
+    uint32_t frame_UBO = 0;
+    GLStateCache gl_state;
+    GLStateStats last_frame_gl;
+    FramePacket own_packet;  // what draw(bodies, focus) records into
+    RenderQueue render_queue;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef SCREEN_CAPTURE_H
+#define SCREEN_CAPTURE_H
+
+#include <glad/glad.h>
+#include <gl_state_cache.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+// receives a finished read: RGBA rows, bottom row first. the pointer is only valid during the call.
+typedef std::function<void(const uint8_t *pixels, uint32_t width, uint32_t height)> CaptureSink;
+
+// reads the framebuffer back without stalling the frame: glReadPixels goes into one of a ring
+// of pixel pack buffers, and the pixels are only mapped once the GPU's fence for that read has
+// passed, a frame or two later. the sink then copies them off to a thread of its own.
+class ScreenCapture {
+public:
+    explicit ScreenCapture(size_t ring_size = 3);
+
+    // queue a read of the current read framebuffer for 'sink'. when every buffer of the ring is
+    // still in flight this either captures nothing and returns false, or with 'wait_when_full'
+    // blocks until the oldest read is done.
+    bool capture(uint32_t width, uint32_t height, CaptureSink sink, bool wait_when_full = false);
+
+    // hand every finished read to its sink; call once per frame
+    void poll();
+
+    // block until every queued read has been handed to its sink
+    void finish();
+
+    // finish and delete the buffers; needs the GL context, so call it before tearing that down
+    void release();
+
+    size_t in_flight() const { return pending.size(); }
+
+    // bind the pixel pack buffers through 'state', which shadows the same context, from now on;
+    // NULL binds them directly
+    void use_state_cache(GLStateCache *state) { state_cache = state; }
+
+private:
+    struct Slot {
+        GLuint buffer = 0;
+        size_t capacity = 0;
+        GLsync fence = NULL;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        CaptureSink sink;
+    };
+
+    void hand_over(Slot &slot);
+
+    void bind_pack_buffer(GLuint buffer);
+
+    std::vector<Slot> slots;
+    GLStateCache *state_cache = NULL;
+    std::deque<size_t> pending;  // slots with a read in flight, oldest first
+};
+
+#endif
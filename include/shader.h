@@ -2,145 +2,554 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <embedded_assets.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// a uniform resolved once after link, typed by the value it takes. location -1 stands for a
+// uniform the program does not use; setting it does nothing, like glUniform* with -1.
+template<typename T>
+struct Uniform {
+    GLint location = -1;
+
+    bool active() const { return location >= 0; }
+};
+
+// preprocessor definitions a program variant is compiled with, "NAME" or "NAME VALUE" each
+using ShaderDefines = std::vector<std::string>;
 
 class Shader {
 public:
     unsigned int ID;
 
-    // constructor generates the shader on the fly
-    Shader(const char *vertexPath, const char *fragmentPath) {
-        // retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
+    // 32-bit FNV-1a of a uniform name, so handles can be looked up by names hashed at compile time
+    static constexpr uint32_t uniformHash(const char *name, uint32_t hash = 2166136261u) {
+        return *name == 0 ? hash : uniformHash(name + 1, (hash ^ (uint8_t) *name) * 16777619u);
+    }
 
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-        try {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
+    // constructor generates the shader on the fly. sources come from load_asset: the copies built
+    // into the executable unless an asset directory overrides them. given a cache directory, the
+    // linked program is saved there and loaded back on later runs instead of compiling, as long as
+    // the sources and the driver are the same; a binary the driver rejects falls back to compiling.
+    Shader(const char *vertexPath, const char *fragmentPath, const char *cacheDirectory = NULL)
+        : Shader(vertexPath, fragmentPath, ShaderDefines(), cacheDirectory) {}
 
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();
+    // the same sources specialised by a define set, see preprocess. a background build only
+    // submits the work: poll buildDone() and call finishBuild() once it is, before using the program.
+    Shader(const char *vertexPath, const char *fragmentPath, const ShaderDefines &defines,
+           const char *cacheDirectory = NULL, bool background = false) {
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::vector<std::string> fragmentFiles;
+        bool vertexRead = preprocess(vertexPath, defines, vertexCode, &sources);
+        bool fragmentRead = preprocess(fragmentPath, defines, fragmentCode, &fragmentFiles);
+        for (const std::string &file: fragmentFiles)
+            if (std::find(sources.begin(), sources.end(), file) == sources.end())
+                sources.push_back(file);
+        // a source cut short would only surface as a confusing compile error; the program stays
+        // empty and unlinked instead, still watching every file read so far
+        if (!vertexRead || !fragmentRead) {
+            std::cout << "ERROR::SHADER::PREPROCESS_FAILED: " << (vertexRead ? fragmentPath : vertexPath)
+                      << std::endl;
+            ID = glCreateProgram();
+            return;
+        }
 
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
+        startBuild(vertexCode, fragmentCode, cacheDirectory);
+        if (!background)
+            finishBuild();
+    }
 
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
-        }
-        catch (std::ifstream::failure &e) {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-        }
+    // whether the driver has finished compiling and linking, so finishBuild() will not wait. only
+    // KHR_parallel_shader_compile can tell; without it the answer is always yes.
+    bool buildDone() const {
+        if (!pending || !GLAD_GL_KHR_parallel_shader_compile)
+            return true;
+        GLint done = GL_FALSE;
+        glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
 
-        const char *vShaderCode = vertexCode.c_str();
-        const char *fShaderCode = fragmentCode.c_str();
+    // report compile and link errors, store the binary and read the uniforms; false if it failed
+    bool finishBuild() {
+        if (!pending)
+            return linked;
+        pending = false;
+        checkCompileErrors(pendingVertex, "VERTEX");
+        checkCompileErrors(pendingFragment, "FRAGMENT");
+        linked = checkCompileErrors(ID, "PROGRAM");
+        if (linked && !cachePath.empty())
+            storeBinary(cachePath, cacheKey);
 
-        // compile shaders
-        unsigned int vertex, fragment;
+        // delete the shaders as they're linked into our program now and no longer necessary
+        glDeleteShader(pendingVertex);
+        glDeleteShader(pendingFragment);
+        pendingVertex = pendingFragment = 0;
 
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
+        reflect();
+        return linked;
+    }
 
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
+    // false while a background build is still pending, or when it failed
+    bool isLinked() const { return !pending && linked; }
 
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
+    // whether the program came out of the binary cache rather than the compiler
+    bool fromCache() const { return cached; }
 
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+    // source of one stage as the compiler gets it: every #include "file" line is replaced by
+    // that file, found relative to the including one and pasted once per stage however often it
+    // is included, and the defines follow the #version line. #line directives keep compiler
+    // messages at the line of the original file, the source number being the order files were
+    // first included in (0 for 'path'), which is how 'files' lists them if given.
+    static bool preprocess(const std::string &path, const ShaderDefines &defines, std::string &source,
+                           std::vector<std::string> *files = NULL) {
+        source.clear();
+        std::vector<std::string> included;
+        bool ok = expand(path, &defines, included, source);
+        if (files != NULL)
+            *files = included;
+        return ok;
     }
 
+    // every file the program was built from, includes too
+    const std::vector<std::string> &sourceFiles() const { return sources; }
+
     // activate the shader
     void use() const {
         glUseProgram(ID);
     }
 
-    // utility uniform functions
+    // handle of an active uniform; in debug builds, asking for an inactive one or with the wrong
+    // type is reported. arrays are found under their name with or without "[0]".
+    template<typename T>
+    Uniform<T> uniform(uint32_t nameHash) const {
+        return resolve<T>(nameHash, NULL);
+    }
+
+    template<typename T>
+    Uniform<T> uniform(const char *name) const {
+        return resolve<T>(uniformHash(name), name);
+    }
+
+    // index of an active uniform block, GL_INVALID_INDEX when there is none of that name
+    GLuint uniformBlock(const char *name) const {
+        uint32_t hash = uniformHash(name);
+        for (const BlockInfo &block: blocks)
+            if (block.hash == hash && block.name == name)
+                return block.index;
+        return GL_INVALID_INDEX;
+    }
+
+    // typed setters for handles; the program has to be in use
+    void set(Uniform<bool> u, bool value) const { glUniform1i(u.location, (int) value); }
+
+    void set(Uniform<int> u, int value) const { glUniform1i(u.location, value); }
+
+    void set(Uniform<float> u, float value) const { glUniform1f(u.location, value); }
+
+    void set(Uniform<glm::vec2> u, const glm::vec2 &value) const { glUniform2fv(u.location, 1, &value[0]); }
+
+    void set(Uniform<glm::vec3> u, const glm::vec3 &value) const { glUniform3fv(u.location, 1, &value[0]); }
+
+    void set(Uniform<glm::vec4> u, const glm::vec4 &value) const { glUniform4fv(u.location, 1, &value[0]); }
+
+    void set(Uniform<glm::mat2> u, const glm::mat2 &mat) const {
+        glUniformMatrix2fv(u.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void set(Uniform<glm::mat3> u, const glm::mat3 &mat) const {
+        glUniformMatrix3fv(u.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+    void set(Uniform<glm::mat4> u, const glm::mat4 &mat) const {
+        glUniformMatrix4fv(u.location, 1, GL_FALSE, &mat[0][0]);
+    }
+
+    // utility uniform functions, by name: slower than handles, kept for compatibility
     void setBool(const std::string &name, bool value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int) value);
+        glUniform1i(location(name), (int) value);
     }
 
     void setInt(const std::string &name, int value) const {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(location(name), value);
     }
 
     void setFloat(const std::string &name, float value) const {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(location(name), value);
     }
 
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(location(name), 1, &value[0]);
     }
 
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(location(name), x, y);
     }
 
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(location(name), 1, &value[0]);
     }
 
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(name), x, y, z);
     }
 
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(location(name), 1, &value[0]);
     }
 
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(name), x, y, z, w);
     }
 
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(location(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    struct UniformInfo {
+        uint32_t hash;
+        GLint location;
+        GLenum type;
+        std::string name;
+    };
+
+    struct BlockInfo {
+        uint32_t hash;
+        GLuint index;
+        std::string name;
+    };
+
+    // read every active uniform and uniform block once after link into flat tables sorted by
+    // name hash; uniforms inside blocks have no location and are left out
+    void reflect() {
+        GLint count = 0, longest = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &longest);
+        std::vector<char> name((size_t) std::max(longest, 1));
+        for (GLint i = 0; i < count; i++) {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, (GLuint) i, (GLsizei) name.size(), NULL, &size, &type, name.data());
+            GLint location = glGetUniformLocation(ID, name.data());
+            if (location < 0)
+                continue;
+            std::string uniformName = name.data();
+            uniforms.push_back({uniformHash(uniformName.c_str()), location, type, uniformName});
+            if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0) {
+                uniformName.resize(uniformName.size() - 3);
+                uniforms.push_back({uniformHash(uniformName.c_str()), location, type, uniformName});
+            }
+        }
+        std::sort(uniforms.begin(), uniforms.end(),
+                  [](const UniformInfo &a, const UniformInfo &b) { return a.hash < b.hash; });
+        for (size_t i = 1; i < uniforms.size(); i++)
+            if (uniforms[i].hash == uniforms[i - 1].hash)
+                std::cout << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << uniforms[i - 1].name << ", "
+                          << uniforms[i].name << std::endl;
+
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &longest);
+        name.resize((size_t) std::max(longest, 1));
+        for (GLint i = 0; i < count; i++) {
+            glGetActiveUniformBlockName(ID, (GLuint) i, (GLsizei) name.size(), NULL, name.data());
+            blocks.push_back({uniformHash(name.data()), (GLuint) i, name.data()});
+        }
+    }
+
+    template<typename T>
+    Uniform<T> resolve(uint32_t hash, const char *name) const {
+        Uniform<T> handle;
+        const UniformInfo *info = findUniform(hash);
+        if (info != NULL && (name == NULL || info->name == name)) {
+            handle.location = info->location;
+#ifndef NDEBUG
+            if (!typeMatches(info->type, (const T *) NULL))
+                std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << info->name << std::endl;
+#endif
+        }
+#ifndef NDEBUG
+        else
+            reportInactive(name != NULL ? std::string(name) : "#" + std::to_string(hash));
+#endif
+        return handle;
+    }
+
+    const UniformInfo *findUniform(uint32_t hash) const {
+        auto it = std::lower_bound(uniforms.begin(), uniforms.end(), hash,
+                                   [](const UniformInfo &info, uint32_t h) { return info.hash < h; });
+        return it != uniforms.end() && it->hash == hash ? &*it : NULL;
+    }
+
+    GLint location(const std::string &name) const {
+        const UniformInfo *info = findUniform(uniformHash(name.c_str()));
+        if (info != NULL && info->name == name)
+            return info->location;
+#ifndef NDEBUG
+        reportInactive(name);
+#endif
+        return -1;
+    }
+
+#ifndef NDEBUG
+    // once per name: setting a uniform the linker dropped usually means a typo or dead shader code
+    void reportInactive(const std::string &name) const {
+        if (reportedInactive.insert(name).second)
+            std::cout << "ERROR::SHADER::UNIFORM_INACTIVE: " << name << std::endl;
+    }
+
+    static bool typeMatches(GLenum type, const bool *) { return type == GL_BOOL; }
+
+    static bool typeMatches(GLenum type, const int *) {
+        return type == GL_INT || type == GL_SAMPLER_2D || type == GL_SAMPLER_3D || type == GL_SAMPLER_CUBE
+               || type == GL_SAMPLER_2D_ARRAY;
+    }
+
+    static bool typeMatches(GLenum type, const float *) { return type == GL_FLOAT; }
+
+    static bool typeMatches(GLenum type, const glm::vec2 *) { return type == GL_FLOAT_VEC2; }
+
+    static bool typeMatches(GLenum type, const glm::vec3 *) { return type == GL_FLOAT_VEC3; }
+
+    static bool typeMatches(GLenum type, const glm::vec4 *) { return type == GL_FLOAT_VEC4; }
+
+    static bool typeMatches(GLenum type, const glm::mat2 *) { return type == GL_FLOAT_MAT2; }
+
+    static bool typeMatches(GLenum type, const glm::mat3 *) { return type == GL_FLOAT_MAT3; }
+
+    static bool typeMatches(GLenum type, const glm::mat4 *) { return type == GL_FLOAT_MAT4; }
+
+    mutable std::unordered_set<std::string> reportedInactive;
+#endif
+
+    std::vector<UniformInfo> uniforms;
+    std::vector<BlockInfo> blocks;
+
+    bool cached = false;
+    std::vector<std::string> sources;
+    bool pending = false, linked = false;
+    unsigned int pendingVertex = 0, pendingFragment = 0;
+    std::string cachePath;
+    uint64_t cacheKey = 0;
+
+    // load the program from the binary cache, or hand the sources to the compiler and linker
+    // without waiting for either; finishBuild() collects the result
+    void startBuild(const std::string &vertexCode, const std::string &fragmentCode, const char *cacheDirectory) {
+        ID = glCreateProgram();
+        if (cacheDirectory != NULL && *cacheDirectory != 0 && binaryFormatsAvailable()) {
+            cacheKey = binaryKey(vertexCode, fragmentCode);
+            char name[32];
+            std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long) cacheKey);
+            cachePath = (std::filesystem::path(cacheDirectory) / name).string();
+            if (loadBinary(cachePath, cacheKey)) {
+                linked = true;
+                reflect();
+                return;
+            }
+        }
+
+        const char *vShaderCode = vertexCode.c_str();
+        const char *fShaderCode = fragmentCode.c_str();
+
+        // vertex shader
+        pendingVertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(pendingVertex, 1, &vShaderCode, NULL);
+        glCompileShader(pendingVertex);
+
+        // fragment Shader
+        pendingFragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(pendingFragment, 1, &fShaderCode, NULL);
+        glCompileShader(pendingFragment);
+
+        // shader Program
+        glAttachShader(ID, pendingVertex);
+        glAttachShader(ID, pendingFragment);
+        if (!cachePath.empty())
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(ID);
+        pending = true;
+    }
+
+    // append 'path' with its includes expanded to 'out'; 'defines' is only given for the top file
+    static bool expand(const std::string &path, const ShaderDefines *defines, std::vector<std::string> &files,
+                       std::string &out) {
+        std::string code;
+        files.push_back(std::filesystem::path(path).lexically_normal().generic_string());
+        if (!load_asset(path, code))
+            return false;
+        const std::string fileNumber = std::to_string(files.size() - 1);
+        const size_t fileStart = out.size();
+        if (defines == NULL)
+            out += "#line 1 " + fileNumber + "\n";
+
+        std::istringstream lines(code);
+        std::string line;
+        for (int number = 1; std::getline(lines, line); number++) {
+            size_t first = line.find_first_not_of(" \t");
+            if (first != std::string::npos && line.compare(first, 8, "#include") == 0) {
+                size_t open = line.find('"', first + 8);
+                size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+                if (close == std::string::npos) {
+                    std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << ":" << number << std::endl;
+                    return false;
+                }
+                std::filesystem::path target = std::filesystem::path(path).parent_path()
+                                               / line.substr(open + 1, close - open - 1);
+                std::string targetName = target.lexically_normal().generic_string();
+                if (std::find(files.begin(), files.end(), targetName) == files.end()) {
+                    if (!expand(targetName, NULL, files, out))
+                        return false;
+                    out += "#line " + std::to_string(number + 1) + " " + fileNumber + "\n";
+                } else {
+                    out += "\n";
+                }
+                continue;
+            }
+            out += line;
+            out += '\n';
+            if (defines != NULL && first != std::string::npos && line.compare(first, 8, "#version") == 0) {
+                out += defineLines(*defines);
+                out += "#line " + std::to_string(number + 1) + " 0\n";
+                defines = NULL;
+            }
+        }
+        // no #version: the defines go first
+        if (defines != NULL && !defines->empty())
+            out.insert(fileStart, defineLines(*defines) + "#line 1 0\n");
+        return true;
+    }
+
+    // "NAME" or "NAME VALUE" each
+    static std::string defineLines(const ShaderDefines &defines) {
+        std::string lines;
+        for (const std::string &define: defines)
+            lines += "#define " + define + "\n";
+        return lines;
+    }
+
+    // layout of a cache file, followed by the program binary
+    struct BinaryHeader {
+        char magic[4];
+        uint32_t format;
+        uint64_t key;
+        uint64_t length;
+    };
+
+    // 64-bit FNV-1a of both sources and the driver strings: a driver update or a different GPU
+    // gets binaries of its own rather than ones glProgramBinary would reject
+    static uint64_t binaryKey(const std::string &vertexCode, const std::string &fragmentCode) {
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const char *text) {
+            // the terminating zero is hashed too, so moving text from one part to the next changes the key
+            do {
+                hash = (hash ^ (uint8_t) *text) * 1099511628211ull;
+            } while (*text++ != 0);
+        };
+        mix(vertexCode.c_str());
+        mix(fragmentCode.c_str());
+        for (GLenum name: {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION}) {
+            const GLubyte *value = glGetString(name);
+            mix(value != NULL ? (const char *) value : "");
+        }
+        return hash;
+    }
+
+    // drivers may expose the entry points with no format to save in (Mesa with its disk cache off)
+    static bool binaryFormatsAvailable() {
+        if (!GLAD_GL_ARB_get_program_binary)
+            return false;
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    bool loadBinary(const std::string &path, uint64_t key) {
+        std::ifstream file(path, std::ios::binary);
+        BinaryHeader header;
+        if (!file || !file.read((char *) &header, sizeof(header)) || std::string(header.magic, 4) != "SSPB"
+            || header.key != key || header.length == 0 || header.length > (1u << 30))
+            return false;
+        std::vector<char> binary((size_t) header.length);
+        if (!file.read(binary.data(), (std::streamsize) binary.size()))
+            return false;
+        glProgramBinary(ID, (GLenum) header.format, binary.data(), (GLsizei) binary.size());
+        GLint success = 0;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if (!success) {
+            // rejected (or a format the driver no longer offers): start over from a clean program
+            while (glGetError() != GL_NO_ERROR) {}
+            glDeleteProgram(ID);
+            ID = glCreateProgram();
+            return false;
+        }
+        cached = true;
+        return true;
+    }
+
+    // written under a name of its own and renamed into place, so programs built at the same time
+    // on other threads never leave a torn file behind
+    void storeBinary(const std::string &path, uint64_t key) const {
+        GLint length = 0;
+        glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary((size_t) length);
+        GLenum format = 0;
+        glGetProgramBinary(ID, length, &length, &format, binary.data());
+        BinaryHeader header = {{'S', 'S', 'P', 'B'}, format, key, (uint64_t) length};
+
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        std::string temporary = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            if (!file.write((const char *) &header, sizeof(header)) || !file.write(binary.data(), length)) {
+                std::cout << "ERROR::SHADER::CACHE_NOT_WRITTEN: " << path << std::endl;
+                file.close();
+                std::remove(temporary.c_str());
+                return;
+            }
+        }
+        std::filesystem::rename(temporary, path, error);
+        if (error) {
+            std::cout << "ERROR::SHADER::CACHE_NOT_WRITTEN: " << path << ": " << error.message() << std::endl;
+            std::remove(temporary.c_str());
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
-    static void checkCompileErrors(unsigned int shader, const std::string& type) {
+    static bool checkCompileErrors(unsigned int shader, const std::string& type) {
         int success;
         char infoLog[1024];
         if (type != "PROGRAM") {
@@ -158,7 +567,136 @@ private:
                           << "\n -- --------------------------------------------------- -- " << std::endl;
             }
         }
+        return success != 0;
+    }
+};
+
+// the permutations of one vertex/fragment pair, each define set built into a program of its
+// own the first time it is asked for. sets are matched by a hash of their sorted definitions,
+// so the same set in another order, or listed twice, shares a program. specialising with
+// defines lets the compiler drop dead branches and fold constants that would otherwise be
+// uniform-driven branches run for every fragment.
+class ShaderVariants {
+public:
+    ShaderVariants(const char *vertexPath, const char *fragmentPath, const char *cacheDirectory = NULL)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), cacheDirectory(cacheDirectory != NULL ? cacheDirectory : "") {}
+
+    ShaderVariants(const ShaderVariants &) = delete;
+
+    ShaderVariants &operator=(const ShaderVariants &) = delete;
+
+    // the program for 'defines', compiled (or loaded from the binary cache) on first use
+    Shader &get(const ShaderDefines &defines) {
+        ShaderDefines sorted = defines;
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        uint64_t key = 14695981039346656037ull;
+        for (const std::string &define: sorted) {
+            const char *c = define.c_str();
+            do {
+                key = (key ^ (uint8_t) *c) * 1099511628211ull;
+            } while (*c++ != 0);
+        }
+        Variant &variant = variants[key];
+        if (!variant.program) {
+            variant.defines = sorted;
+            variant.program.reset(build(sorted, false));
+        }
+        return *variant.program;
+    }
+
+    // build every listed variant now, at load time, rather than stalling the frame that first needs one
+    void prepare(const std::vector<ShaderDefines> &sets) {
+        for (const ShaderDefines &defines: sets)
+            get(defines);
     }
+
+    // rebuild every variant from the sources as they are now, in the background where the driver
+    // has KHR_parallel_shader_compile. the programs in use stay until poll() swaps in replacements
+    // that linked; a rebuild that is still running is dropped for the newer one.
+    void reload() {
+        if (GLAD_GL_KHR_parallel_shader_compile)
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        for (auto &entry: variants) {
+            Variant &variant = entry.second;
+            if (variant.rebuild)
+                dropped.push_back(std::move(variant.rebuild));
+            variant.rebuild.reset(build(variant.defines, true));
+        }
+    }
+
+    // swap in the rebuilt programs whose build is done, without waiting for any other. true if a
+    // program was replaced: references from get() are stale then and have to be fetched again.
+    bool poll() {
+        bool swapped = false;
+        for (auto &entry: variants) {
+            Variant &variant = entry.second;
+            if (!variant.rebuild || !variant.rebuild->buildDone())
+                continue;
+            if (variant.rebuild->finishBuild()) {
+                glDeleteProgram(variant.program->ID);
+                variant.program = std::move(variant.rebuild);
+                swapped = true;
+            } else {
+                // keep drawing with the last program that worked; the errors are printed already
+                glDeleteProgram(variant.rebuild->ID);
+                variant.rebuild.reset();
+            }
+        }
+        for (auto it = dropped.begin(); it != dropped.end();) {
+            if ((*it)->buildDone()) {
+                (*it)->finishBuild();
+                glDeleteProgram((*it)->ID);
+                it = dropped.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        return swapped;
+    }
+
+    // every file some variant was built from, includes too
+    std::vector<std::string> sourceFiles() const {
+        std::vector<std::string> files;
+        for (const auto &entry: variants)
+            for (const std::string &file: entry.second.program->sourceFiles())
+                if (std::find(files.begin(), files.end(), file) == files.end())
+                    files.push_back(file);
+        return files;
+    }
+
+    size_t size() const { return variants.size(); }
+
+    // delete every program, waiting for rebuilds still running; the context has to be current
+    void release() {
+        for (auto &entry: variants) {
+            if (entry.second.rebuild)
+                dropped.push_back(std::move(entry.second.rebuild));
+            glDeleteProgram(entry.second.program->ID);
+        }
+        for (std::unique_ptr<Shader> &program: dropped) {
+            program->finishBuild();
+            glDeleteProgram(program->ID);
+        }
+        variants.clear();
+        dropped.clear();
+    }
+
+private:
+    struct Variant {
+        ShaderDefines defines;
+        std::unique_ptr<Shader> program;
+        std::unique_ptr<Shader> rebuild;  // being compiled in the background to replace 'program'
+    };
+
+    Shader *build(const ShaderDefines &defines, bool background) const {
+        return new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines,
+                          cacheDirectory.empty() ? NULL : cacheDirectory.c_str(), background);
+    }
+
+    std::string vertexPath, fragmentPath, cacheDirectory;
+    std::unordered_map<uint64_t, Variant> variants;
+    std::vector<std::unique_ptr<Shader>> dropped;  // superseded rebuilds, deleted once the driver is done with them
 };
 
 #endif
\ No newline at end of file
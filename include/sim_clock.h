@@ -0,0 +1,97 @@
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// simulation time is an integer count of ticks since day 0, so any instant can be named exactly
+// and used as a cache key. one tick is one millisecond of simulated time.
+typedef int64_t SimTick;
+
+const SimTick SIM_TICKS_PER_DAY = 24LL * 60 * 60 * 1000;
+const SimTick SIM_TICKS_PER_HOUR = SIM_TICKS_PER_DAY / 24;
+
+// ticks for a rational number of days, exact whenever the fraction lands on a whole tick
+inline SimTick sim_ticks_from_days(int64_t numerator, int64_t denominator = 1) {
+    return numerator / denominator * SIM_TICKS_PER_DAY
+           + numerator % denominator * SIM_TICKS_PER_DAY / denominator;
+}
+
+inline SimTick sim_ticks_from_days(double days) {
+    return (SimTick) std::llround(days * (double) SIM_TICKS_PER_DAY);
+}
+
+// whole days and the remainder are converted separately to keep the fraction precise far from day 0
+inline double sim_days(SimTick tick) {
+    return (double) (tick / SIM_TICKS_PER_DAY) + (double) (tick % SIM_TICKS_PER_DAY) / (double) SIM_TICKS_PER_DAY;
+}
+
+// fraction of a turn in [0, 1) for something turning 'turns_per_day' times a day, with the
+// elapsed time already split into whole days and the fraction of the current day
+inline double sim_turn_fraction(double whole_days, double part_day, double turns_per_day) {
+    double whole = whole_days * turns_per_day;
+    double turns = (whole - std::floor(whole)) + part_day * turns_per_day;
+    return turns - std::floor(turns);
+}
+
+inline double sim_turn_fraction(SimTick tick, double turns_per_day) {
+    return sim_turn_fraction((double) (tick / SIM_TICKS_PER_DAY),
+                             (double) (tick % SIM_TICKS_PER_DAY) / (double) SIM_TICKS_PER_DAY, turns_per_day);
+}
+
+class SimClock {
+public:
+    explicit SimClock(SimTick start = 0) : now(start) {}
+
+    SimTick tick() const { return now; }
+
+    double day() const { return sim_days(now); }
+
+    // jump straight to an instant, nothing in between is simulated
+    void seek(SimTick tick) { now = tick; }
+
+    void advance(SimTick ticks) { now += ticks; }
+
+private:
+    SimTick now;
+};
+
+// runs the simulation at a fixed rate no matter how often frames are drawn. elapsed wall time is
+// banked and paid out in whole steps; whatever is left over places the rendered frame between the
+// last two steps.
+class FixedStep {
+public:
+    // 'sim_ticks_per_second' is how much simulated time passes per second of wall time
+    FixedStep(double steps_per_second, SimTick sim_ticks_per_second, int max_steps = 8)
+            : step_seconds(1.0 / steps_per_second), max_steps(max_steps), banked(0.0) {
+        step_ticks = std::max<SimTick>(1, (SimTick) std::llround((double) sim_ticks_per_second * step_seconds));
+    }
+
+    // banks the wall time since the last call and returns how many steps are due. a frame that
+    // stalls for long is not caught up beyond 'max_steps', the simulation slows down instead.
+    int accumulate(double wall_seconds) {
+        banked += std::max(wall_seconds, 0.0);
+        int steps = (int) std::floor(banked / step_seconds);
+        if (steps > max_steps) {
+            steps = max_steps;
+            banked = 0.0;
+        } else {
+            banked -= steps * step_seconds;
+        }
+        return steps;
+    }
+
+    // how far past the last step the wall clock is, as a fraction of a step
+    double alpha() const { return std::min(banked / step_seconds, 1.0); }
+
+    SimTick ticks() const { return step_ticks; }
+
+private:
+    double step_seconds;
+    int max_steps;
+    double banked;
+    SimTick step_ticks;
+};
+
+#endif
@@ -0,0 +1,172 @@
+#ifndef SIMD_FLOAT_H
+#define SIMD_FLOAT_H
+
+// thin wrapper over the widest float vector the compiler was told it may use:
+// AVX2+FMA (8 lanes), SSE2 (4 lanes) or plain scalar code (1 lane).
+// kernels written against vfloat/vint/vmask compile unchanged for all three.
+
+#include <cstdint>
+#include <cmath>
+
+#if defined(__AVX2__) && defined(__FMA__)
+
+#include <immintrin.h>
+
+#define SIMD_FLOAT_WIDTH 8
+
+struct vfloat { __m256 v; };
+struct vint { __m256i v; };
+struct vmask { __m256 v; };
+
+inline vfloat v_set1(float x) { return {_mm256_set1_ps(x)}; }
+inline vfloat v_load(const float *p) { return {_mm256_load_ps(p)}; }
+inline vfloat v_loadu(const float *p) { return {_mm256_loadu_ps(p)}; }
+inline void v_store(float *p, vfloat a) { _mm256_store_ps(p, a.v); }
+inline void v_storeu(float *p, vfloat a) { _mm256_storeu_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a) { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))}; }
+
+// a * b + c
+inline vfloat v_fmadd(vfloat a, vfloat b, vfloat c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+inline vfloat v_min(vfloat a, vfloat b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline vfloat v_max(vfloat a, vfloat b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline vfloat v_sqrt(vfloat a) { return {_mm256_sqrt_ps(a.v)}; }
+inline vfloat v_abs(vfloat a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+
+inline vmask v_lt(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+inline vmask v_gt(vfloat a, vfloat b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+inline vfloat v_select(vmask m, vfloat a, vfloat b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+inline vfloat v_negate_if(vmask m, vfloat a) {
+    return {_mm256_xor_ps(a.v, _mm256_and_ps(m.v, _mm256_set1_ps(-0.0f)))};
+}
+inline vmask v_and(vmask a, vmask b) { return {_mm256_and_ps(a.v, b.v)}; }
+inline bool v_all(vmask m) { return _mm256_movemask_ps(m.v) == 0xff; }
+// one bit per lane, lane 0 in bit 0
+inline int v_mask_bits(vmask m) { return _mm256_movemask_ps(m.v); }
+inline float v_sum(vfloat a) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    return _mm_cvtss_f32(_mm_add_ss(lo, _mm_shuffle_ps(lo, lo, 1)));
+}
+
+// round to nearest integer under the default rounding mode
+inline vint v_round_int(vfloat a) { return {_mm256_cvtps_epi32(a.v)}; }
+inline vfloat v_to_float(vint a) { return {_mm256_cvtepi32_ps(a.v)}; }
+inline vint v_int_add(vint a, int32_t b) { return {_mm256_add_epi32(a.v, _mm256_set1_epi32(b))}; }
+// lanes where any of the given bits are set
+inline vmask v_int_test(vint a, int32_t bits) {
+    __m256i b = _mm256_set1_epi32(bits);
+    __m256i zero = _mm256_setzero_si256();
+    return {_mm256_castsi256_ps(_mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_and_si256(a.v, b), zero),
+                                                 _mm256_cmpeq_epi32(zero, zero)))};
+}
+
+#elif defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+
+#include <emmintrin.h>
+
+#define SIMD_FLOAT_WIDTH 4
+
+struct vfloat { __m128 v; };
+struct vint { __m128i v; };
+struct vmask { __m128 v; };
+
+inline vfloat v_set1(float x) { return {_mm_set1_ps(x)}; }
+inline vfloat v_load(const float *p) { return {_mm_load_ps(p)}; }
+inline vfloat v_loadu(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void v_store(float *p, vfloat a) { _mm_store_ps(p, a.v); }
+inline void v_storeu(float *p, vfloat a) { _mm_storeu_ps(p, a.v); }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {_mm_add_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a, vfloat b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline vfloat operator*(vfloat a, vfloat b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline vfloat operator/(vfloat a, vfloat b) { return {_mm_div_ps(a.v, b.v)}; }
+inline vfloat operator-(vfloat a) { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))}; }
+
+// a * b + c
+inline vfloat v_fmadd(vfloat a, vfloat b, vfloat c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+inline vfloat v_min(vfloat a, vfloat b) { return {_mm_min_ps(a.v, b.v)}; }
+inline vfloat v_max(vfloat a, vfloat b) { return {_mm_max_ps(a.v, b.v)}; }
+inline vfloat v_sqrt(vfloat a) { return {_mm_sqrt_ps(a.v)}; }
+inline vfloat v_abs(vfloat a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+
+inline vmask v_lt(vfloat a, vfloat b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+inline vmask v_gt(vfloat a, vfloat b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+inline vfloat v_select(vmask m, vfloat a, vfloat b) {
+    return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+}
+inline vfloat v_negate_if(vmask m, vfloat a) {
+    return {_mm_xor_ps(a.v, _mm_and_ps(m.v, _mm_set1_ps(-0.0f)))};
+}
+inline vmask v_and(vmask a, vmask b) { return {_mm_and_ps(a.v, b.v)}; }
+inline bool v_all(vmask m) { return _mm_movemask_ps(m.v) == 0xf; }
+// one bit per lane, lane 0 in bit 0
+inline int v_mask_bits(vmask m) { return _mm_movemask_ps(m.v); }
+inline float v_sum(vfloat a) {
+    __m128 sum = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+    return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+}
+
+// round to nearest integer under the default rounding mode
+inline vint v_round_int(vfloat a) { return {_mm_cvtps_epi32(a.v)}; }
+inline vfloat v_to_float(vint a) { return {_mm_cvtepi32_ps(a.v)}; }
+inline vint v_int_add(vint a, int32_t b) { return {_mm_add_epi32(a.v, _mm_set1_epi32(b))}; }
+// lanes where any of the given bits are set
+inline vmask v_int_test(vint a, int32_t bits) {
+    __m128i b = _mm_set1_epi32(bits);
+    __m128i zero = _mm_setzero_si128();
+    return {_mm_castsi128_ps(_mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(a.v, b), zero),
+                                           _mm_cmpeq_epi32(zero, zero)))};
+}
+
+#else
+
+#define SIMD_FLOAT_WIDTH 1
+
+struct vfloat { float v; };
+struct vint { int32_t v; };
+struct vmask { bool v; };
+
+inline vfloat v_set1(float x) { return {x}; }
+inline vfloat v_load(const float *p) { return {*p}; }
+inline vfloat v_loadu(const float *p) { return {*p}; }
+inline void v_store(float *p, vfloat a) { *p = a.v; }
+inline void v_storeu(float *p, vfloat a) { *p = a.v; }
+
+inline vfloat operator+(vfloat a, vfloat b) { return {a.v + b.v}; }
+inline vfloat operator-(vfloat a, vfloat b) { return {a.v - b.v}; }
+inline vfloat operator*(vfloat a, vfloat b) { return {a.v * b.v}; }
+inline vfloat operator/(vfloat a, vfloat b) { return {a.v / b.v}; }
+inline vfloat operator-(vfloat a) { return {-a.v}; }
+
+// a * b + c
+inline vfloat v_fmadd(vfloat a, vfloat b, vfloat c) { return {a.v * b.v + c.v}; }
+inline vfloat v_min(vfloat a, vfloat b) { return {a.v < b.v ? a.v : b.v}; }
+inline vfloat v_max(vfloat a, vfloat b) { return {a.v > b.v ? a.v : b.v}; }
+inline vfloat v_sqrt(vfloat a) { return {std::sqrt(a.v)}; }
+inline vfloat v_abs(vfloat a) { return {std::fabs(a.v)}; }
+
+inline vmask v_lt(vfloat a, vfloat b) { return {a.v < b.v}; }
+inline vmask v_gt(vfloat a, vfloat b) { return {a.v > b.v}; }
+inline vfloat v_select(vmask m, vfloat a, vfloat b) { return m.v ? a : b; }
+inline vfloat v_negate_if(vmask m, vfloat a) { return {m.v ? -a.v : a.v}; }
+inline vmask v_and(vmask a, vmask b) { return {a.v && b.v}; }
+inline bool v_all(vmask m) { return m.v; }
+// one bit per lane, lane 0 in bit 0
+inline int v_mask_bits(vmask m) { return m.v ? 1 : 0; }
+inline float v_sum(vfloat a) { return a.v; }
+
+// round to nearest integer under the default rounding mode
+inline vint v_round_int(vfloat a) { return {(int32_t) std::lrint(a.v)}; }
+inline vfloat v_to_float(vint a) { return {(float) a.v}; }
+inline vint v_int_add(vint a, int32_t b) { return {a.v + b}; }
+// lanes where any of the given bits are set
+inline vmask v_int_test(vint a, int32_t bits) { return {(a.v & bits) != 0}; }
+
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef SOFT_RASTERIZER_H
+#define SOFT_RASTERIZER_H
+
+#include <glm/glm.hpp>
+#include <aligned_vector.h>
+#include <thread_pool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// CPU stand-in for the GL scene pass, for machines without any usable GL. it follows shader.vs
+// and shader.fs: triangle lists with a position and a color per vertex, transformed by
+// projection * view * model, colors interpolated perspective-correctly, GL_LESS depth test
+// against a [0, 1] depth buffer. nothing is culled, like the GL path.
+// triangles are binned into 64x64 pixel tiles which are rasterized in parallel. inside a tile,
+// 8x8 pixel blocks are rejected or accepted whole against the triangle's edges and against the
+// farthest depth left in the block before any pixel is tested.
+class SoftRasterizer {
+public:
+    // 0 threads picks one per hardware thread
+    explicit SoftRasterizer(size_t threads = 0);
+
+    void resize(uint32_t width, uint32_t height);
+
+    uint32_t width() const { return frame_width; }
+
+    uint32_t height() const { return frame_height; }
+
+    // fill the color buffer and reset every depth to the far plane
+    void clear(float r, float g, float b);
+
+    // draw 'vertex_count' vertices as a triangle list once per model matrix, depth tested against
+    // everything drawn since the last clear. vertices are interleaved x, y, z, r, g, b floats, the
+    // layout of the GL vertex buffer. instances are drawn in order, so depth ties keep the earlier one.
+    void draw_instanced(const float *vertices, size_t vertex_count, const glm::mat4 &view,
+                        const glm::mat4 &projection, const glm::mat4 *models, size_t instance_count);
+
+    // RGBA color buffer, rows bottom-up like glReadPixels
+    const uint8_t *pixels() const { return color.data(); }
+
+private:
+    // a triangle in window coordinates. edges and attribute planes are taken relative to x0, y0;
+    // a pixel is inside when every edge is above its threshold at the pixel's center.
+    struct Triangle {
+        float x0, y0;
+        float edge_a[3], edge_b[3], edge_c[3];
+        float edge_min[3];  // 0, or just below 0 for top and left edges that own their pixels
+        float z[3];         // value at x0, y0, then the x and y gradients
+        float inv_w[3];
+        float r[3], g[3], b[3];  // color divided by w, for perspective-correct interpolation
+        float z_min, z_max;
+        int32_t min_x, min_y, max_x, max_y;  // covered pixel bounds, inside the frame
+    };
+
+    // triangles set up from one contiguous run of instances, with their per-tile bins
+    struct Chunk {
+        std::vector<Triangle> triangles;
+        std::vector<std::vector<uint32_t>> bins;
+    };
+
+    void setup_instances(Chunk &chunk, const float *vertices, size_t vertex_count, const glm::mat4 &view_projection,
+                         const glm::mat4 *models, size_t begin, size_t end);
+
+    // clip against the near plane; the other planes only reject whole triangles, the rest is
+    // cut off by the pixel bounds
+    void clip_triangle(Chunk &chunk, const glm::vec4 *clip, const glm::vec3 *rgb);
+
+    void bin_triangle(Chunk &chunk, const glm::vec4 *clip, const glm::vec3 *rgb);
+
+    void rasterize_tile(size_t tile, size_t chunk_count);
+
+    // depth test one 8x8 block; owner is the block's first entry in the tile's owner table
+    void rasterize_block(const Triangle &t, int32_t bx, int32_t by, bool covered, const Triangle **owner);
+
+    ThreadPool pool;
+    uint32_t frame_width = 0, frame_height = 0;
+    uint32_t tiles_x = 0, tiles_y = 0;
+    uint32_t blocks_x = 0, blocks_y = 0;
+    std::vector<uint8_t> color;
+    aligned_vector<float> depth;     // padded to whole blocks, depth_stride floats per row
+    std::vector<float> block_far;    // per block, never nearer than the farthest depth in it
+    size_t depth_stride = 0;
+    std::vector<Chunk> chunks;
+};
+
+#endif
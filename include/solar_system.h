@@ -0,0 +1,22 @@
+#ifndef SOLAR_SYSTEM_H
+#define SOLAR_SYSTEM_H
+
+#include <body_registry.h>
+#include <nbody.h>
+#include <spk.h>
+
+#include <cstddef>
+#include <cstdint>
+
+// the sun, the earth and the moon on their fixed orbits. returns the moon's index.
+int32_t build_solar_system(BodyRegistry &bodies);
+
+// the sun, the earth and a disc of asteroids moved by gravity. returns the sun's index.
+// body i of the registry is body i of the N-body system.
+int32_t build_nbody_system(BodyRegistry &bodies, NBodySystem &nbody, size_t asteroid_count);
+
+// positions of the build_solar_system bodies taken from an SPK kernel, tick 0 being J2000.
+// directions are real; distances are rescaled to the scene's sun-earth and earth-moon spacing.
+bool spk_solar_system_positions(SpkKernel &kernel, SimTick tick, float *x, float *y, float *z);
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef SPK_H
+#define SPK_H
+
+#include <glm/glm.hpp>
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// NAIF ids of the bodies the scene uses
+const int32_t NAIF_SOLAR_SYSTEM_BARYCENTER = 0;
+const int32_t NAIF_EARTH_MOON_BARYCENTER = 3;
+const int32_t NAIF_SUN = 10;
+const int32_t NAIF_MOON = 301;
+const int32_t NAIF_EARTH = 399;
+
+struct SpkSegmentInfo {
+    int32_t target;
+    int32_t center;
+    int32_t frame;     // 1 = J2000 equatorial, 17 = J2000 ecliptic
+    int32_t type;      // 2 = chebyshev position, 3 = chebyshev position and velocity
+    double start_et;   // ephemeris time covered, seconds past J2000
+    double end_et;
+};
+
+// reader for NASA SPICE SPK kernels (DAF container, segment types 2 and 3).
+// the file is memory mapped; opening only walks the summary records, segment data is read
+// in place from the mapping the first time a segment is used. recently used segments are
+// remembered per target so repeated lookups skip the summary search.
+class SpkKernel {
+public:
+    SpkKernel() = default;
+
+    ~SpkKernel() { close(); }
+
+    SpkKernel(const SpkKernel &) = delete;
+
+    SpkKernel &operator=(const SpkKernel &) = delete;
+
+    bool open(const std::string &path);
+
+    void close();
+
+    bool is_open() const { return data != NULL; }
+
+    size_t segment_count() const { return segments.size(); }
+
+    SpkSegmentInfo segment_info(size_t segment) const { return segments[segment].info; }
+
+    // position (km) and optionally velocity (km/s) of 'target' relative to the center of the
+    // segment covering 'et', in that segment's frame. returns false if no segment covers it.
+    bool state(int32_t target, double et, int32_t &center, glm::dvec3 &pos, glm::dvec3 *vel = NULL);
+
+    // position of 'target' relative to 'observer', chaining segments through their centers
+    bool position(int32_t target, int32_t observer, double et, glm::dvec3 &pos);
+
+    size_t cache_hits = 0;
+    size_t cache_misses = 0;
+
+private:
+    struct Segment {
+        SpkSegmentInfo info;
+        uint32_t begin, end;  // first and last double of the segment, 1-based DAF addresses
+        bool decoded = false;
+        double init = 0.0, interval = 0.0;
+        uint32_t record_size = 0, record_count = 0;
+    };
+
+    struct CacheEntry {
+        int32_t target = INT32_MIN;
+        uint32_t segment = 0;
+    };
+
+    double read_double(uint64_t address) const;
+
+    int32_t read_int(uint64_t byte_offset) const;
+
+    const Segment *find_segment(int32_t target, double et);
+
+    bool decode(Segment &segment) const;
+
+    void evaluate(const Segment *segment, double et, glm::dvec3 &pos, glm::dvec3 *vel) const;
+
+    // chain a body back to the solar system barycenter, in ecliptic coordinates
+    bool barycentric(int32_t body, double et, glm::dvec3 &pos);
+
+    const unsigned char *data = NULL;
+    size_t size = 0;
+    bool swap_bytes = false;
+    std::vector<Segment> segments;
+
+    static const size_t CACHE_SIZE = 8;
+    CacheEntry cache[CACHE_SIZE];
+    size_t cache_next = 0;
+
+#ifdef _WIN32
+    void *file_handle = NULL;
+    void *mapping_handle = NULL;
+#endif
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// bounded lock-free queue between exactly one producer thread and one consumer thread. each index
+// is written by one side only and published with release, so a slot's contents are visible once
+// its index is. neither side ever blocks; waiting is up to the caller.
+template<typename T>
+class SpscQueue {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    // producer side; false when full
+    bool push(const T &value) {
+        size_t tail_index = tail.load(std::memory_order_relaxed);
+        if (tail_index - head.load(std::memory_order_acquire) == slots.size())
+            return false;
+        slots[tail_index & mask] = value;
+        tail.store(tail_index + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false when empty
+    bool pop(T &value) {
+        size_t head_index = head.load(std::memory_order_relaxed);
+        if (head_index == tail.load(std::memory_order_acquire))
+            return false;
+        value = slots[head_index & mask];
+        head.store(head_index + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t mask = 0;
+    // on lines of their own, so the two sides do not invalidate each other's cache line
+    alignas(64) std::atomic<size_t> head{0};  // next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};  // next slot to push, written by the producer
+};
+
+#endif
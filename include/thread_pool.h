@@ -0,0 +1,44 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// fixed set of worker threads fed from one task queue
+class ThreadPool {
+public:
+    // 0 threads picks one per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    size_t size() const { return workers.size(); }
+
+    // queue a task to run on some worker
+    std::future<void> submit(std::function<void()> task);
+
+    // run fn(begin, end) over [0, count) in chunks of 'grain' items and wait for all of them.
+    // the calling thread works on chunks too, so this is safe to use with a single worker.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)> &fn);
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::packaged_task<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+};
+
+#endif
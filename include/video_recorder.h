@@ -0,0 +1,93 @@
+#ifndef VIDEO_RECORDER_H
+#define VIDEO_RECORDER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class VideoFormat {
+    Y4M,    // YUV4MPEG2 with 4:2:0 chroma, BT.601 studio range; readable by ffmpeg and most encoders
+    RawRGB  // bare RGB24 frames, top row first, nothing in between
+};
+
+// picked by file extension: .y4m is Y4M, anything else raw RGB. "-" is stdout as Y4M.
+VideoFormat video_format_from_path(const std::string &path);
+
+struct VideoRecorderStats {
+    size_t frames_written = 0;
+    size_t frames_dropped = 0;  // given up on because the ring was full (or the frame did not fit)
+    size_t stalls = 0;          // times push_frame waited for the encoder instead of dropping
+    uint64_t bytes_written = 0;
+};
+
+// streams frames to a file or to stdout. frames are copied into a fixed ring of buffers and
+// converted and written by an encoder thread; when the ring is full the newest frame is either
+// dropped or the caller waits for a free buffer, as chosen at open().
+class VideoRecorder {
+public:
+    VideoRecorder() = default;
+
+    // finishes the stream
+    ~VideoRecorder();
+
+    VideoRecorder(const VideoRecorder &) = delete;
+
+    VideoRecorder &operator=(const VideoRecorder &) = delete;
+
+    bool open(const std::string &path, VideoFormat format, uint32_t width, uint32_t height,
+              double frames_per_second, size_t ring_frames = 8, bool drop_when_full = true);
+
+    // writes every queued frame and closes the output
+    void close();
+
+    bool is_open() const { return output != NULL; }
+
+    // queue one frame of 8-bit RGB or RGBA pixels. returns false when the frame was dropped.
+    bool push_frame(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool bottom_up);
+
+    // count a frame that was given up on before it reached the recorder
+    void drop_frame();
+
+    VideoRecorderStats stats();
+
+private:
+    struct Frame {
+        std::vector<uint8_t> pixels;
+        uint32_t channels = 4;
+        bool bottom_up = false;
+    };
+
+    void encoder_loop();
+
+    bool write_frame(const Frame &frame);
+
+    std::FILE *output = NULL;
+    bool owns_output = false;
+    VideoFormat format = VideoFormat::Y4M;
+    uint32_t width = 0, height = 0;
+    bool drop_when_full = true;
+
+    // frames [head, head + queued) of the ring wait for the encoder
+    std::vector<Frame> ring;
+    size_t head = 0, queued = 0;
+    std::mutex mutex;
+    std::condition_variable filled, emptied;
+    bool stopping = false;
+    std::thread encoder;
+
+    // conversion scratch, only touched by the encoder thread
+    std::vector<uint8_t> planes;
+    VideoRecorderStats counters;
+};
+
+// RGB(A) rows to 4:2:0 planes: BT.601 studio range luma and chroma, chroma averaged over 2x2 pixels.
+// 'y' is width x height, 'u' and 'v' are (width + 1) / 2 x (height + 1) / 2.
+void rgb_to_yuv420(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool bottom_up,
+                   uint8_t *y, uint8_t *u, uint8_t *v);
+
+#endif
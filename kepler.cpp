@@ -0,0 +1,253 @@
+#include <kepler.h>
+#include <fast_trig.h>
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+
+static const double PI = 3.14159265358979323846;
+static const double TWO_PI = 2.0 * PI;
+static const int KEPLER_MAX_ITERATIONS = 8;
+static const float KEPLER_TOLERANCE = 1.0e-5f;
+
+static size_t padded_count(size_t n) {
+    return (n + SIMD_FLOAT_WIDTH - 1) / SIMD_FLOAT_WIDTH * SIMD_FLOAT_WIDTH;
+}
+
+// wrap an angle into [-pi, pi)
+static double wrap_angle(double angle) {
+    return angle - TWO_PI * std::floor((angle + PI) / TWO_PI);
+}
+
+void KeplerOrbits::resize_columns(size_t padded) {
+    // padding lanes are degenerate orbits (a = 0, e = 0) that evaluate to the origin
+    inclination.resize(padded, 0.0f);
+    raan.resize(padded, 0.0f);
+    argp.resize(padded, 0.0f);
+    m0.resize(padded, 0.0f);
+    turns_per_day.resize(padded, 0.0);
+    mean_motion.resize(padded, 0.0f);
+    semi_major.resize(padded, 0.0f);
+    semi_minor.resize(padded, 0.0f);
+    eccentricity.resize(padded, 0.0f);
+    p_x.resize(padded, 0.0f);
+    p_y.resize(padded, 0.0f);
+    p_z.resize(padded, 0.0f);
+    q_x.resize(padded, 0.0f);
+    q_y.resize(padded, 0.0f);
+    q_z.resize(padded, 0.0f);
+    mean_anomaly.resize(padded, 0.0f);
+}
+
+void KeplerOrbits::reserve(size_t n) {
+    size_t padded = padded_count(n);
+    inclination.reserve(padded);
+    raan.reserve(padded);
+    argp.reserve(padded);
+    m0.reserve(padded);
+    turns_per_day.reserve(padded);
+    mean_motion.reserve(padded);
+    semi_major.reserve(padded);
+    semi_minor.reserve(padded);
+    eccentricity.reserve(padded);
+    p_x.reserve(padded);
+    p_y.reserve(padded);
+    p_z.reserve(padded);
+    q_x.reserve(padded);
+    q_y.reserve(padded);
+    q_z.reserve(padded);
+    mean_anomaly.reserve(padded);
+}
+
+void KeplerOrbits::clear() {
+    count = 0;
+    resize_columns(0);
+}
+
+size_t KeplerOrbits::add_orbit(const OrbitalElements &el) {
+    size_t index = count++;
+    resize_columns(padded_count(count));
+
+    double a = el.a, e = el.e;
+    double n = std::sqrt(mu / (a * a * a));
+    double ci = std::cos((double) el.i), si = std::sin((double) el.i);
+    double co = std::cos((double) el.raan), so = std::sin((double) el.raan);
+    double cw = std::cos((double) el.argp), sw = std::sin((double) el.argp);
+
+    inclination[index] = el.i;
+    raan[index] = el.raan;
+    argp[index] = el.argp;
+    m0[index] = (float) wrap_angle(el.m0);
+    turns_per_day[index] = n / TWO_PI;
+    mean_motion[index] = (float) n;
+    semi_major[index] = el.a;
+    semi_minor[index] = (float) (a * std::sqrt(1.0 - e * e));
+    eccentricity[index] = el.e;
+
+    // perifocal axes in the ecliptic frame (z up), stored in scene axes: (x, z, -y)
+    double px = co * cw - so * sw * ci, py = so * cw + co * sw * ci, pz = sw * si;
+    double qx = -co * sw - so * cw * ci, qy = -so * sw + co * cw * ci, qz = cw * si;
+    p_x[index] = (float) px;
+    p_y[index] = (float) pz;
+    p_z[index] = (float) -py;
+    q_x[index] = (float) qx;
+    q_y[index] = (float) qz;
+    q_z[index] = (float) -qy;
+    return index;
+}
+
+size_t KeplerOrbits::add_states(SimTick epoch, size_t n,
+                                const float *x, const float *y, const float *z,
+                                const float *vx, const float *vy, const float *vz) {
+    size_t added = 0;
+    for (size_t k = 0; k < n; k++) {
+        // back from scene axes to the ecliptic frame
+        glm::dvec3 r(x[k], -z[k], y[k]);
+        glm::dvec3 v(vx[k], -vz[k], vy[k]);
+
+        double r_len = glm::length(r);
+        double v2 = glm::dot(v, v);
+        glm::dvec3 h = glm::cross(r, v);
+        double h_len = glm::length(h);
+        double energy = 0.5 * v2 - mu / r_len;
+        if (r_len <= 0.0 || h_len <= 0.0 || energy >= 0.0)
+            continue;
+
+        glm::dvec3 e_vec = ((v2 - mu / r_len) * r - glm::dot(r, v) * v) / mu;
+        double e = glm::length(e_vec);
+        if (e >= 1.0)
+            continue;
+
+        // signed angle from 'from' to 'to' measured around the angular momentum
+        auto angle_around_h = [&h, h_len](const glm::dvec3 &from, const glm::dvec3 &to) {
+            return std::atan2(glm::dot(glm::cross(from, to), h) / h_len, glm::dot(from, to));
+        };
+
+        OrbitalElements el;
+        el.a = (float) (-mu / (2.0 * energy));
+        el.e = (float) e;
+        el.i = (float) std::acos(glm::clamp(h.z / h_len, -1.0, 1.0));
+
+        // the node line is undefined for planar orbits, fall back to the x axis
+        glm::dvec3 node(-h.y, h.x, 0.0);
+        if (glm::length(node) < 1.0e-12 * h_len)
+            node = glm::dvec3(1.0, 0.0, 0.0);
+        el.raan = (float) std::atan2(node.y, node.x);
+
+        // periapsis is undefined for circular orbits, measure from the node instead
+        const double circular = 1.0e-9;
+        double argp = e > circular ? angle_around_h(node, e_vec) : 0.0;
+        double nu = e > circular ? angle_around_h(e_vec, r) : angle_around_h(node, r);
+        el.argp = (float) argp;
+
+        double ecc_anomaly = std::atan2(std::sqrt(1.0 - e * e) * std::sin(nu), e + std::cos(nu));
+        double mean_at_epoch = ecc_anomaly - e * std::sin(ecc_anomaly);
+        double turns = std::sqrt(mu / ((double) el.a * el.a * el.a)) / TWO_PI;
+        el.m0 = (float) wrap_angle(mean_at_epoch - TWO_PI * sim_turn_fraction(epoch, turns));
+
+        add_orbit(el);
+        added++;
+    }
+    return added;
+}
+
+OrbitalElements KeplerOrbits::elements(size_t orbit) const {
+    OrbitalElements el;
+    el.a = semi_major[orbit];
+    el.e = eccentricity[orbit];
+    el.i = inclination[orbit];
+    el.raan = raan[orbit];
+    el.argp = argp[orbit];
+    el.m0 = m0[orbit];
+    return el;
+}
+
+void KeplerOrbits::propagate(SimTick tick, float *x, float *y, float *z) {
+    propagate_columns<false>(tick, x, y, z, NULL, NULL, NULL);
+}
+
+void KeplerOrbits::propagate(SimTick tick, float *x, float *y, float *z, float *vx, float *vy, float *vz) {
+    propagate_columns<true>(tick, x, y, z, vx, vy, vz);
+}
+
+template<bool with_velocity>
+void KeplerOrbits::propagate_columns(SimTick tick, float *x, float *y, float *z, float *vx, float *vy, float *vz) {
+    const size_t padded = padded_count(count);
+
+    // mean anomaly: the phase is reduced in double so far-off ticks keep full float precision
+    const double whole_days = (double) (tick / SIM_TICKS_PER_DAY);
+    const double part_day = (double) (tick % SIM_TICKS_PER_DAY) / (double) SIM_TICKS_PER_DAY;
+    for (size_t k = 0; k < padded; k++)
+        mean_anomaly[k] = (float) (TWO_PI * sim_turn_fraction(whole_days, part_day, turns_per_day[k]));
+
+    const vfloat pi = v_set1((float) PI);
+    const vfloat two_pi = v_set1((float) TWO_PI);
+    const vfloat one = v_set1(1.0f);
+    const vfloat tolerance = v_set1(KEPLER_TOLERANCE);
+
+    for (size_t k = 0; k < padded; k += SIMD_FLOAT_WIDTH) {
+        vfloat e = v_load(&eccentricity[k]);
+        vfloat m = v_load(&mean_anomaly[k]) + v_load(&m0[k]);
+        m = v_select(v_gt(m, pi), m - two_pi, m);
+
+        // Danby's starting guess converges for every e < 1
+        vfloat sign = v_select(v_lt(m, v_set1(0.0f)), -one, one);
+        vfloat ecc = v_fmadd(v_set1(0.85f) * e, sign, m);
+        vfloat s, c;
+        for (int iteration = 0; iteration < KEPLER_MAX_ITERATIONS; iteration++) {
+            v_sincos(ecc, s, c);
+            vfloat f = ecc - v_fmadd(e, s, m);
+            vfloat step = f / (one - e * c);
+            ecc = ecc - step;
+            if (v_all(v_lt(v_abs(step), tolerance)))
+                break;
+        }
+        v_sincos(ecc, s, c);
+
+        vfloat a = v_load(&semi_major[k]);
+        vfloat b = v_load(&semi_minor[k]);
+        vfloat along_p = a * (c - e);
+        vfloat along_q = b * s;
+
+        vfloat px = v_load(&p_x[k]), py = v_load(&p_y[k]), pz = v_load(&p_z[k]);
+        vfloat qx = v_load(&q_x[k]), qy = v_load(&q_y[k]), qz = v_load(&q_z[k]);
+
+        // full vectors go straight to the caller, the last partial one through a bounce buffer
+        alignas(32) float tail[6][SIMD_FLOAT_WIDTH];
+        bool full = k + SIMD_FLOAT_WIDTH <= count;
+        float *out_x = full ? x + k : tail[0];
+        float *out_y = full ? y + k : tail[1];
+        float *out_z = full ? z + k : tail[2];
+        v_storeu(out_x, v_fmadd(along_p, px, along_q * qx));
+        v_storeu(out_y, v_fmadd(along_p, py, along_q * qy));
+        v_storeu(out_z, v_fmadd(along_p, pz, along_q * qz));
+
+        float *out_vx = tail[3], *out_vy = tail[4], *out_vz = tail[5];
+        if (with_velocity) {
+            vfloat rate = v_load(&mean_motion[k]) / (one - e * c);
+            vfloat speed_p = -(a * s * rate);
+            vfloat speed_q = b * c * rate;
+            if (full) {
+                out_vx = vx + k;
+                out_vy = vy + k;
+                out_vz = vz + k;
+            }
+            v_storeu(out_vx, v_fmadd(speed_p, px, speed_q * qx));
+            v_storeu(out_vy, v_fmadd(speed_p, py, speed_q * qy));
+            v_storeu(out_vz, v_fmadd(speed_p, pz, speed_q * qz));
+        }
+
+        if (!full) {
+            for (size_t lane = 0; k + lane < count; lane++) {
+                x[k + lane] = tail[0][lane];
+                y[k + lane] = tail[1][lane];
+                z[k + lane] = tail[2][lane];
+                if (with_velocity) {
+                    vx[k + lane] = tail[3][lane];
+                    vy[k + lane] = tail[4][lane];
+                    vz[k + lane] = tail[5][lane];
+                }
+            }
+        }
+    }
+}
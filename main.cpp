@@ -5,337 +5,426 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <string>
-#include <filesystem>
-#include <shader.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <solar_system.h>
+#include <ephemeris.h>
+#include <batch_renderer.h>
+#include <frame_pacer.h>
+#include <headless_context.h>
+#include <image_writer.h>
+#include <render_thread.h>
+#include <screen_capture.h>
+#include <scene_renderer.h>
+#include <thread_pool.h>
+#include <video_recorder.h>
 
 static uint32_t ss_id = 0;
+static bool paused = false;
+static bool capture_requested = false;
+// framebuffer size reported since the last frame, 0 when unchanged
+static int resized_width = 0, resized_height = 0;
 const int SCR_WIDTH = 1024;
 const int SCR_HEIGHT = 768;
-const float HOURS_PER_DAY = 24;
-const float SUN_EARTH_DISTANCE = 24.0f;
-const float EARTH_MOON_DISTANCE = 12.0f;
-const float REVOLVE_DEGREES = 360.0f;
-const float SUN_REVOLVE_DAYS = 27.0f;
-const float EARTH_REVOLVE_DAYS = 1.0f;
-const float EARTH_ORBIT_DAYS = 365.0f;
-const float MOON_REVOLVE_DAYS = 28.0f;
-const float MOON_ORBIT_DAYS = 28.0f;
 const double FRAME_RATE = 60.0;
-
-double prev_time = 0.0f;
-double delta_time = 0.0f;
-
-void dump_framebuffer_to_ppm(std::string prefix, uint32_t width, uint32_t height);
+// frame rate while the window is in the background
+const double BACKGROUND_FRAME_RATE = 10.0;
+// longest sleep while nothing on screen changes; input wakes the loop earlier
+const double IDLE_WAIT_SECONDS = 0.25;
+// how often --frame-stats prints the pacing statistics
+const double FRAME_STATS_SECONDS = 5.0;
+// simulated time per second of wall time: one hour per frame at 60 frames per second
+const SimTick SIM_TICKS_PER_WALL_SECOND = 60 * SIM_TICKS_PER_HOUR;
 
 void process_input(GLFWwindow *window);
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 
-float get_sun_rotate_angle_around_itself(float day);
-
-float get_earth_rotate_angle_around_sun(float day);
-
-float get_earth_rotate_angle_around_itself(float day);
-
-float get_moon_rotate_angle_around_earth(float day);
-
-float get_moon_rotate_angle_around_itself(float day);
-
-void get_position_from_angle(float angle, float radius, float &adj_pos, float &opp_pos);
-
-bool should_render();
-
-glm::vec3 draw_sun(float day, Shader *shader);
-
-glm::vec3 draw_earth(float day, glm::vec3 orbit_center, Shader *shader);
-
-glm::vec3 draw_moon(float day, glm::vec3 orbit_center, Shader *shader);
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+
+void print_frame_stats(const FramePacingStats &stats);
+
+int main(int argc, char **argv) {
+    // --nbody <count>: move the sun, earth and <count> asteroids by gravity instead of fixed orbits
+    // --ephemeris <path>: take positions from a table written by ephemeris_gen for the same scene
+    // --spk <path>: place the sun, earth and moon from a SPICE SPK kernel, day 0 being J2000
+    // --sim-hz <rate>: simulation steps per wall second, independent of the frame rate
+    // --vsync: let buffer swaps wait for the display instead of pacing frames with sleeps
+    // --frame-stats: print frame pacing statistics every few seconds
+    // --verify-gl-state: check the GL state cache against glGet after every call it makes (slow)
+    // --capture-format <ppm|qoi|png>: file format of screenshots
+    // --record <path>: stream every rendered frame to a .y4m file, raw RGB for other names, Y4M on stdout for -
+    // --record-block: make rendering wait for the video encoder instead of dropping frames
+    // --headless: render offscreen without a window, as fast as possible, for --frames frames
+    // --frames <count>: frames to render in headless mode, each one 1/60 s of the usual timeline;
+    //                   the last one is also saved as a screenshot
+    // --software: draw with the CPU rasterizer instead of OpenGL, no GL context needed; implies --headless
+    // --camera <x>,<y>,<z>: where the camera sits, it always looks at the focus body
+    // --fov <degrees>: vertical field of view
+    // --assets <dir>: read shaders from files under <dir>, e.g. the source tree, instead of the copies
+    //                 built in; edits are picked up while running, without restarting
+    // --shader-cache <dir>: keep linked shader programs in <dir> to skip compiling on later runs,
+    //                       "" to always compile; shader_cache by default
+    // --batch <first day>:<last day>:<step hours>: render an image per instant instead of running
+    //                                              interactively, e.g. 0:3650:6
+    // --batch-times <path>: same, for a file listing the days to render
+    // --workers <count>: batch render threads, each with a context of its own; one per hardware thread by default
+    // --output <prefix>: batch images are <prefix>_<index>.<capture format>
+    size_t nbody_count = 0, headless_frames = 600;
+    double sim_hz = 60.0;
+    bool vsync = false, frame_stats = false, record_block = false, headless = false, software = false;
+    bool hot_reload = false, verify_gl_state = false;
+    std::string ephemeris_path, spk_path, capture_format = "ppm", record_path, shader_cache = DEFAULT_SHADER_CACHE;
+    SceneCamera camera;
+    BatchSettings batch;
+    bool batch_requested = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--nbody" && i + 1 < argc)
+            nbody_count = std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--ephemeris" && i + 1 < argc)
+            ephemeris_path = argv[++i];
+        else if (arg == "--spk" && i + 1 < argc)
+            spk_path = argv[++i];
+        else if (arg == "--sim-hz" && i + 1 < argc)
+            sim_hz = std::strtod(argv[++i], NULL);
+        else if (arg == "--vsync")
+            vsync = true;
+        else if (arg == "--frame-stats")
+            frame_stats = true;
+        else if (arg == "--verify-gl-state")
+            verify_gl_state = true;
+        else if (arg == "--capture-format" && i + 1 < argc)
+            capture_format = argv[++i];
+        else if (arg == "--record" && i + 1 < argc)
+            record_path = argv[++i];
+        else if (arg == "--record-block")
+            record_block = true;
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--frames" && i + 1 < argc)
+            headless_frames = std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--software")
+            software = headless = true;
+        else if (arg == "--camera" && i + 1 < argc)
+            std::sscanf(argv[++i], "%f,%f,%f", &camera.eye.x, &camera.eye.y, &camera.eye.z);
+        else if (arg == "--fov" && i + 1 < argc)
+            camera.fov_degrees = std::strtof(argv[++i], NULL);
+        else if (arg == "--assets" && i + 1 < argc) {
+            set_asset_directory(argv[++i]);
+            hot_reload = true;
+        }
+        else if (arg == "--shader-cache" && i + 1 < argc)
+            shader_cache = argv[++i];
+        else if (arg == "--batch" && i + 1 < argc) {
+            if (!parse_batch_range(argv[++i], batch.ticks))
+                return -1;
+            batch_requested = true;
+        } else if (arg == "--batch-times" && i + 1 < argc) {
+            if (!load_batch_times(argv[++i], batch.ticks))
+                return -1;
+            batch_requested = true;
+        } else if (arg == "--workers" && i + 1 < argc)
+            batch.workers = std::strtoul(argv[++i], NULL, 10);
+        else if (arg == "--output" && i + 1 < argc)
+            batch.output_prefix = argv[++i];
+    }
+    if (!(sim_hz > 0.0))
+        sim_hz = 60.0;
+    // the video owns stdout, messages go to stderr instead
+    if (record_path == "-")
+        std::cout.rdbuf(std::cerr.rdbuf());
+    if (batch_requested) {
+        batch.format = capture_format;
+        batch.software = software;
+        batch.width = SCR_WIDTH;
+        batch.height = SCR_HEIGHT;
+        batch.camera = camera;
+        batch.shader_cache = shader_cache;
+        batch.nbody_count = nbody_count;
+        batch.ephemeris_path = ephemeris_path;
+        batch.spk_path = spk_path;
+        BatchReport report;
+        if (!render_batch(batch, report))
+            return -1;
+        std::cout << "Rendered " << report.frames << " frames on " << report.workers << " workers in "
+                  << report.seconds << " s, " << report.frames_per_second << " frames/s" << std::endl;
+        return 0;
+    }
 
-int main() {
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+    // nobody watches a headless run, so every frame is recorded rather than dropped
+    if (headless)
+        record_block = true;
+
+    // GL belongs to the render thread: this thread handles events, simulates and records frames,
+    // the render thread draws and presents them
+    GLFWwindow *window = NULL;
+    HeadlessContext offscreen;
+    RenderContext render_context;
+    int frame_width = SCR_WIDTH, frame_height = SCR_HEIGHT;
+    if (headless) {
+        if (!software) {
+            render_context.attach = [&offscreen]() { return offscreen.create(SCR_WIDTH, SCR_HEIGHT); };
+            render_context.detach = [&offscreen]() { offscreen.destroy(); };
+        }
+    } else {
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Solar System", NULL, NULL);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Solar System", NULL, NULL);
 
-    if (window == NULL) {
-        std::cout << "GLFW Window Failed" << std::endl;
-        glfwTerminate();
-        return -1;
+        if (window == NULL) {
+            std::cout << "GLFW Window Failed" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetKeyCallback(window, key_callback);
+        glfwSwapInterval(vsync ? 1 : 0);
+
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            std::cout << "GLAD Initialization Failed" << std::endl;
+            return -1;
+        }
+        glfwGetFramebufferSize(window, &frame_width, &frame_height);
+        // a context is current on one thread at a time; swapping is allowed from any thread
+        glfwMakeContextCurrent(NULL);
+        render_context.attach = [window]() {
+            glfwMakeContextCurrent(window);
+            return true;
+        };
+        render_context.detach = []() { glfwMakeContextCurrent(NULL); };
+        render_context.present = [window]() { glfwSwapBuffers(window); };
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        std::cout << "GLAD Initialization Failed" << std::endl;
-        return -1;
+    SceneRenderer renderer;
+    renderer.set_shader_cache(shader_cache);
+    renderer.set_hot_reload(hot_reload);
+    renderer.gl_state_cache().set_verify(verify_gl_state);
+    renderer.set_camera(camera);
+
+    BodyRegistry bodies;
+    NBodySystem nbody;
+    int32_t focus;
+    if (nbody_count > 0)
+        focus = build_nbody_system(bodies, nbody, nbody_count);
+    else
+        focus = build_solar_system(bodies);
+
+    EphemerisTable ephemeris;
+    bool use_ephemeris = false;
+    if (!ephemeris_path.empty() && ephemeris.load(ephemeris_path)) {
+        use_ephemeris = ephemeris.body_count() == bodies.size();
+        if (!use_ephemeris)
+            std::cout << "Ephemeris has " << ephemeris.body_count() << " bodies, scene has " << bodies.size()
+                      << ", ignoring it" << std::endl;
     }
 
-    // configure global openGL state
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LESS);
-//    glEnable(GL_CULL_FACE);
-//    glCullFace(GL_BACK);
-
-    // build and compile shader program
-    Shader shader("shaders/shader.vs", "shaders/shader.fs");
-
-    // cube vertices
-    float vertices[] = {
-            // back face, yellow
-            -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-            1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-            1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-            1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-            -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-            -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
-
-            // front face, purple
-            -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-            1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-            1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-            1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-            -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-            -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
-
-            // right face, green
-            1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-            1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-            1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
-            1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-            1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
-
-            // left face, red
-            -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-            -1.0f, 1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
-            -1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
-            -1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
-            -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-            -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
-
-            // bottom face, light blue
-            -1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
-            1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
-            1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-            1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-            -1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
-            -1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
-
-            // top face, blue
-            -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
-            1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
-            1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
-            -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+    SpkKernel spk;
+    bool use_spk = nbody_count == 0 && !spk_path.empty() && spk.open(spk_path);
+
+    // positions handed to the registry when they do not come from its own orbits
+    std::vector<float> body_x(bodies.size()), body_y(bodies.size()), body_z(bodies.size());
+
+    // the simulation advances in fixed steps; frames are drawn between the last two of them.
+    // orbits, ephemeris and kernel are evaluated right at the frame's instant, n-body positions
+    // are interpolated between the two stepped states.
+    SimClock clock;
+    FixedStep stepper(sim_hz, SIM_TICKS_PER_WALL_SECOND);
+    SimTick prev_tick = clock.tick();
+    bool stepped = nbody.size() > 0 && !use_ephemeris;
+    std::vector<float> step_x(body_x), step_y(body_y), step_z(body_z);
+    if (stepped)
+        nbody.copy_positions(step_x.data(), step_y.data(), step_z.data());
+    std::vector<float> prev_x(step_x), prev_y(step_y), prev_z(step_z);
+
+    // screenshots are read back asynchronously and written by a thread of their own
+    ImageWriter image_writer;
+
+    // recording reads back every frame through the same capture ring
+    VideoRecorder recorder;
+    if (!record_path.empty())
+        recorder.open(record_path, video_format_from_path(record_path), frame_width, frame_height, FRAME_RATE,
+                      8, !record_block);
+
+    // runs on the render thread, which alone uses the screenshot counter and the recorder until it stops
+    auto output_frame = [&image_writer, &recorder, &capture_format, record_block](
+            SceneRenderer &renderer, ScreenCapture &screen_capture, const RenderFrame &frame) {
+        if (frame.screenshot) {
+            std::string file_name = "Assignment0-ss" + std::to_string(ss_id) + "." + capture_format;
+            auto write_screenshot = [&image_writer, file_name](const uint8_t *pixels, uint32_t width,
+                                                               uint32_t height) {
+                image_writer.submit(file_name, pixels, width, height, 4, true);
+            };
+            // asked for once, so it waits for a free slot rather than being dropped behind video frames
+            if (renderer.capture(screen_capture, write_screenshot, true))
+                std::cout << "Capture Window " << ss_id++ << std::endl;
+        }
+        if (recorder.is_open()) {
+            auto push_video_frame = [&recorder](const uint8_t *pixels, uint32_t width, uint32_t height) {
+                recorder.push_frame(pixels, width, height, 4, true);
+            };
+            if (!renderer.capture(screen_capture, push_video_frame, record_block))
+                recorder.drop_frame();
+        }
     };
 
-    uint32_t VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-
-    // bind Vertex Array Object
-    glBindVertexArray(VAO);
-
-    // bind vertices array to a vertex buffer
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-    // position attribute
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) 0);
-    glEnableVertexAttribArray(0);
-
-    // color attribute
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) (3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-
-    float day = 0.0f, inc = 1.0f / HOURS_PER_DAY;
-
-    glm::mat4 view = glm::mat4(1.0f);
-    glm::mat4 proj = glm::mat4(1.0f);
-    proj = glm::perspective(glm::radians(30.0f), (float) 4 / (float) 3, 0.1f, 1000.0f);
-
-    while (!glfwWindowShouldClose(window)) {
-        process_input(window);
-
-        if (should_render()) {
-            // background color
-            glClearColor(0.3f, 0.4f, 0.5f, 1.0f);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-            // activate shader
-            shader.use();
-            shader.setMat4("view", view);
-            shader.setMat4("projection", proj);
-
-            // render container
-            glBindVertexArray(VAO);
-
-            glm::vec3 sun_pos = draw_sun(day, &shader);
-            glm::vec3 earth_pos = draw_earth(day, sun_pos, &shader);
-            glm::vec3 moon_pos = draw_moon(day, earth_pos, &shader);
-
-            view = glm::lookAt(glm::vec3(100.0f, 50.0f, 100.0f), moon_pos, glm::vec3(0.0f, 1.0f, 0.0f));
+    RenderThread render_thread;
+    if (!render_thread.start(renderer, software, frame_width, frame_height, render_context, output_frame)) {
+        if (window)
+            glfwTerminate();
+        return -1;
+    }
+    // the renderer is the render thread's now; only what it settled on at init is read here
+    const InstanceTransform instance_transform = renderer.packet_transform();
+    // scenes of more than one chunk are recorded spread over a pool, the calling thread included;
+    // smaller ones are recorded on this thread alone and start no workers
+    std::unique_ptr<ThreadPool> record_pool;
+    if (bodies.size() > RECORD_CHUNK_BODIES)
+        record_pool.reset(new ThreadPool());
+    GLStateStats gl_stats;
+
+    // headless runs take one frame period of the timeline per frame, drawn as fast as they go
+    FramePacer pacer(FRAME_RATE);
+    size_t frames_drawn = 0;
+    double last_time = window ? glfwGetTime() : 0.0, last_stats = last_time;
+    bool drawn_paused = false;
+    while (window ? !glfwWindowShouldClose(window) : frames_drawn < headless_frames) {
+        bool minimized = false;
+        if (window) {
+            // sleep until the next frame is due, or until input arrives while nothing would change
+            minimized = glfwGetWindowAttrib(window, GLFW_ICONIFIED) != 0;
+            bool focused = glfwGetWindowAttrib(window, GLFW_FOCUSED) != 0;
+            if (minimized || (paused && drawn_paused)) {
+                glfwWaitEventsTimeout(IDLE_WAIT_SECONDS);
+            } else if (!focused) {
+                glfwWaitEventsTimeout(1.0 / BACKGROUND_FRAME_RATE);
+            } else {
+                if (!vsync)
+                    pacer.wait();
+                glfwPollEvents();
+            }
+            process_input(window);
+        }
 
-            day += inc;
+        // run the simulation steps that fell due since the last pass; paused time is dropped
+        double now = window ? glfwGetTime() : (double) frames_drawn / FRAME_RATE;
+        int steps = paused ? 0 : stepper.accumulate(now - last_time);
+        last_time = now;
+        for (int s = 0; s < steps; s++) {
+            prev_tick = clock.tick();
+            clock.advance(stepper.ticks());
+            if (stepped) {
+                prev_x.swap(step_x);
+                prev_y.swap(step_y);
+                prev_z.swap(step_z);
+                nbody.step((float) sim_days(stepper.ticks()));
+                nbody.copy_positions(step_x.data(), step_y.data(), step_z.data());
+            }
+        }
 
-            glfwSwapBuffers(window);
+        if (headless && frames_drawn + 1 == headless_frames)
+            capture_requested = true;
+        if (!minimized && (!(paused && drawn_paused) || capture_requested)) {
+
+            // move every body to the frame's instant between the last two steps
+            double alpha = stepper.alpha();
+            SimTick tick = prev_tick + (SimTick) std::llround(alpha * (double) (clock.tick() - prev_tick));
+            if (use_spk && spk_solar_system_positions(spk, tick, body_x.data(), body_y.data(), body_z.data())) {
+                bodies.seek(tick, body_x.data(), body_y.data(), body_z.data());
+            } else if (use_ephemeris) {
+                ephemeris.evaluate(tick, body_x.data(), body_y.data(), body_z.data());
+                bodies.seek(tick, body_x.data(), body_y.data(), body_z.data());
+            } else if (stepped) {
+                float t = (float) alpha;
+                for (size_t i = 0; i < body_x.size(); i++) {
+                    body_x[i] = prev_x[i] + (step_x[i] - prev_x[i]) * t;
+                    body_y[i] = prev_y[i] + (step_y[i] - prev_y[i]) * t;
+                    body_z[i] = prev_z[i] + (step_z[i] - prev_z[i]) * t;
+                }
+                bodies.seek(tick, body_x.data(), body_y.data(), body_z.data());
+            } else {
+                bodies.seek(tick);
+            }
+            // frames come back in the order they were presented, which is what the pacing statistics measure
+            RenderFrame *frame = render_thread.acquire();
+            gl_stats = frame->gl_stats;
+            if (frame->presented)
+                pacer.frame_presented(frame->presented_at);
+            record_frame(bodies, focus, camera, (float) frame_width / (float) frame_height,
+                         instance_transform, frame->packet, record_pool.get());
+            frame->screenshot = capture_requested;
+            capture_requested = false;
+            if (resized_width > 0) {
+                frame->viewport_width = resized_width;
+                frame->viewport_height = resized_height;
+                resized_width = resized_height = 0;
+            }
+            render_thread.submit(frame);
+
+            drawn_paused = paused;
+            frames_drawn++;
         }
 
-        glfwPollEvents();
+        if (frame_stats && now - last_stats >= FRAME_STATS_SECONDS) {
+            print_frame_stats(pacer.stats());
+            if (!software)
+                std::cout << "GL state calls last frame: issued " << gl_stats.issued << ", filtered "
+                          << gl_stats.filtered << std::endl;
+            pacer.reset_stats();
+            last_stats = now;
+        }
     }
 
     //release resource
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    render_thread.stop();
+    if (recorder.is_open()) {
+        recorder.close();
+        VideoRecorderStats stats = recorder.stats();
+        std::cout << "Recorded " << stats.frames_written << " frames (" << stats.bytes_written / (1024 * 1024)
+                  << " MB), dropped " << stats.frames_dropped << ", stalled " << stats.stalls << " times"
+                  << std::endl;
+    }
 
-    glfwTerminate();
+    if (window)
+        glfwTerminate();
     return 0;
 }
 
-glm::vec3 draw_sun(float day, Shader *shader) {
-    glm::mat4 model = glm::mat4(1.0f);
-    float sun_x = 0.0f, sun_y = 0.0f, sun_z = 0.0f;
-    glm::mat4 sun = glm::scale(model, glm::vec3(6.0f, 6.0f, 6.0f));
-    sun = glm::rotate(sun,
-                      (float) glm::radians(get_sun_rotate_angle_around_itself(day)),
-                      glm::vec3(0.0f, 1.0f, 0.0f));
-    shader->setMat4("model", sun);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    return {sun_x, sun_y, sun_z};
-}
-
-glm::vec3 draw_earth(float day, glm::vec3 orbit_center, Shader *shader) {
-    glm::mat4 model = glm::mat4(1.0f);
-    float earth_x = 0.0f, earth_y = 0.0f, earth_z = 0.0f;
-    float earth_orbit_degree = get_earth_rotate_angle_around_sun(day);
-    get_position_from_angle(earth_orbit_degree, SUN_EARTH_DISTANCE, earth_x, earth_z);
-
-    glm::mat4 earth = glm::translate(
-            model,
-            glm::vec3(orbit_center[0] + earth_x, orbit_center[1] + earth_y, orbit_center[2] + earth_z));
-    earth = glm::scale(earth, glm::vec3(3.0f, 3.0f, 3.0f));
-    earth = glm::rotate(earth, (float) glm::radians(-23.4), glm::vec3(0.0f, 0.0f, 1.0f));
-    earth = glm::rotate(earth,
-                        (float) glm::radians(get_earth_rotate_angle_around_itself(day)),
-                        glm::vec3(0.0f, 1.0f, 0.0f));
-
-    shader->setMat4("model", earth);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    return {earth_x, earth_y, earth_z};
-
-}
-
-glm::vec3 draw_moon(float day, glm::vec3 orbit_center, Shader *shader) {
-    glm::mat4 model = glm::mat4(1.0f);
-    float moon_x = 0.0f, moon_y = 0.0f, moon_z = 0.0f;
-    float moon_orbit_degree = get_moon_rotate_angle_around_earth(day);
-    get_position_from_angle(moon_orbit_degree, EARTH_MOON_DISTANCE, moon_x, moon_z);
-
-    glm::mat4 moon = glm::scale(moon, glm::vec3(1.5f, 1.5f, 1.5f));
-    moon = glm::translate(
-            model,
-            glm::vec3(orbit_center[0] + moon_x, orbit_center[1] + moon_y, orbit_center[2] + moon_z));
-    moon = glm::rotate(moon,
-                       (float) glm::radians(get_moon_rotate_angle_around_itself(day)),
-                       glm::vec3(0.0f, 1.0f, 0.0f));
-
-    shader->setMat4("model", moon);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    return {moon_x, moon_y, moon_z};
-}
-
-void get_position_from_angle(float angle, float radius, float &adj_pos, float &opp_pos) {
-    adj_pos = radius * (float) cos(glm::radians(angle));
-    opp_pos = -radius * (float) sin(glm::radians(angle));
-}
-
-float get_sun_rotate_angle_around_itself(float day) {
-    float revolveDegPerDay = REVOLVE_DEGREES / SUN_REVOLVE_DAYS;
-    return day * revolveDegPerDay;
-}
-
-float get_earth_rotate_angle_around_sun(float day) {
-    float revolveDegPerDay = REVOLVE_DEGREES / EARTH_ORBIT_DAYS;
-    return day * revolveDegPerDay;
+void print_frame_stats(const FramePacingStats &stats) {
+    std::cout << "Frames " << stats.frames << ", interval " << stats.mean_ms << " ms (min " << stats.min_ms
+              << ", max " << stats.max_ms << "), jitter " << stats.jitter_ms << " ms, missed " << stats.missed
+              << std::endl;
 }
 
-float get_earth_rotate_angle_around_itself(float day) {
-    float revolveDegPerDay = REVOLVE_DEGREES / EARTH_REVOLVE_DAYS;
-    return day * revolveDegPerDay;
-}
-
-float get_moon_rotate_angle_around_earth(float day) {
-    float revolveDegPerDay = REVOLVE_DEGREES / MOON_ORBIT_DAYS;
-    return day * revolveDegPerDay;
-}
-
-float get_moon_rotate_angle_around_itself(float day) {
-    float revolveDegPerDay = REVOLVE_DEGREES / MOON_REVOLVE_DAYS;
-    return day * revolveDegPerDay;
+void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
+    // applied by the render thread with the next frame
+    resized_width = width;
+    resized_height = height;
 }
 
-bool should_render() {
-    double cur_time = glfwGetTime();
-    delta_time += (cur_time - prev_time);
-    prev_time = cur_time;
+void key_callback(GLFWwindow *, int key, int, int action, int) {
+    //press space to pause or resume the simulation
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS)
+        paused = !paused;
 
-    // check if the time elapsed is greater than or equal the frame rate
-    if (delta_time >= 1.0 / FRAME_RATE) {
-        delta_time -= 1.0 / FRAME_RATE;
-        return true;
-    }
-    return false;
-}
-
-void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-    glViewport(0, 0, width, height);
+    //press p to capture screen, once per press
+    if (key == GLFW_KEY_P && action == GLFW_PRESS)
+        capture_requested = true;
 }
 
 void process_input(GLFWwindow *window) {
     //press escape to exit
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
-
-    //press p to capture screen
-    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
-        std::cout << "Capture Window " << ss_id << std::endl;
-        int buffer_width, buffer_height;
-        glfwGetFramebufferSize(window, &buffer_width, &buffer_height);
-        dump_framebuffer_to_ppm("Assignment0-ss", buffer_width, buffer_height);
-    }
-}
-
-void dump_framebuffer_to_ppm(std::string prefix, uint32_t width, uint32_t height) {
-    int pixelChannel = 3;
-    int totalPixelSize = pixelChannel * width * height * sizeof(GLubyte);
-    GLubyte *pixels = new GLubyte[totalPixelSize];
-    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels);
-
-    std::string fileName = prefix + std::to_string(ss_id) + ".ppm";
-    std::filesystem::path filePath = std::filesystem::current_path() / fileName;
-    std::ofstream fout(filePath.string());
-
-    fout << "P3\n" << width << " " << height << "\n" << 255 << std::endl;
-    for (size_t i = 0; i < height; i++) {
-        for (size_t j = 0; j < width; j++) {
-            size_t cur = pixelChannel * ((height - i - 1) * width + j);
-            fout << (int) pixels[cur] << " " << (int) pixels[cur + 1] << " " << (int) pixels[cur + 2] << " ";
-        }
-        fout << std::endl;
-    }
-
-    ss_id++;
-
-    delete[] pixels;
-    fout.flush();
-    fout.close();
 }
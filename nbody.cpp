@@ -0,0 +1,369 @@
+#include <nbody.h>
+#include <simd_float.h>
+
+#include <algorithm>
+#include <cmath>
+
+static const int MORTON_BITS = 21;
+static const int32_t LEAF_SIZE = 16;
+static const size_t LEAF_GRAIN = 32;
+
+// spread the low 21 bits of v so there are two zero bits between each of them
+static uint64_t spread_bits(uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8) & 0x100f00f00f00f00fULL;
+    v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+// LSD radix sort of (key, value) pairs, one byte per pass; passes where every key shares the byte are skipped
+static void radix_sort(std::vector<uint64_t> &keys, std::vector<uint32_t> &values,
+                       std::vector<uint64_t> &keys_tmp, std::vector<uint32_t> &values_tmp) {
+    const size_t n = keys.size();
+    keys_tmp.resize(n);
+    values_tmp.resize(n);
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t count[256] = {0};
+        for (size_t i = 0; i < n; i++)
+            count[(keys[i] >> shift) & 0xff]++;
+        if (count[(keys[0] >> shift) & 0xff] == n)
+            continue;
+
+        size_t offset = 0;
+        for (size_t &c: count) {
+            size_t bucket = c;
+            c = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < n; i++) {
+            size_t dst = count[(keys[i] >> shift) & 0xff]++;
+            keys_tmp[dst] = keys[i];
+            values_tmp[dst] = values[i];
+        }
+        keys.swap(keys_tmp);
+        values.swap(values_tmp);
+    }
+}
+
+NBodySystem::NBodySystem(size_t threads) : pool_threads(threads) {}
+
+ThreadPool &NBodySystem::workers() {
+    if (!pool)
+        pool.reset(new ThreadPool(pool_threads));
+    return *pool;
+}
+
+size_t NBodySystem::add_body(const glm::vec3 &pos, const glm::vec3 &vel, float body_mu) {
+    size_t index = mu.size();
+    pos_x.push_back(pos.x);
+    pos_y.push_back(pos.y);
+    pos_z.push_back(pos.z);
+    vel_x.push_back(vel.x);
+    vel_y.push_back(vel.y);
+    vel_z.push_back(vel.z);
+    acc_x.push_back(0.0f);
+    acc_y.push_back(0.0f);
+    acc_z.push_back(0.0f);
+    mu.push_back(body_mu);
+    id.push_back((uint32_t) index);
+    slot.push_back((uint32_t) index);
+    accelerations_valid = false;
+    return index;
+}
+
+void NBodySystem::reserve(size_t count) {
+    pos_x.reserve(count);
+    pos_y.reserve(count);
+    pos_z.reserve(count);
+    vel_x.reserve(count);
+    vel_y.reserve(count);
+    vel_z.reserve(count);
+    acc_x.reserve(count);
+    acc_y.reserve(count);
+    acc_z.reserve(count);
+    mu.reserve(count);
+    id.reserve(count);
+    slot.reserve(count);
+}
+
+void NBodySystem::step(float dt) {
+    if (mu.empty())
+        return;
+    if (!accelerations_valid) {
+        build_tree();
+        compute_accelerations();
+        accelerations_valid = true;
+    }
+
+    kick(0.5f * dt);
+    drift(dt);
+    build_tree();
+    compute_accelerations();
+    kick(0.5f * dt);
+}
+
+void NBodySystem::kick(float dt) {
+    const size_t n = mu.size();
+    for (size_t i = 0; i < n; i++) {
+        vel_x[i] += acc_x[i] * dt;
+        vel_y[i] += acc_y[i] * dt;
+        vel_z[i] += acc_z[i] * dt;
+    }
+}
+
+void NBodySystem::drift(float dt) {
+    const size_t n = mu.size();
+    for (size_t i = 0; i < n; i++) {
+        pos_x[i] += vel_x[i] * dt;
+        pos_y[i] += vel_y[i] * dt;
+        pos_z[i] += vel_z[i] * dt;
+    }
+}
+
+void NBodySystem::build_tree() {
+    const size_t n = mu.size();
+
+    // bounding cube of every body
+    float min_x = pos_x[0], max_x = pos_x[0];
+    float min_y = pos_y[0], max_y = pos_y[0];
+    float min_z = pos_z[0], max_z = pos_z[0];
+    for (size_t i = 1; i < n; i++) {
+        min_x = std::min(min_x, pos_x[i]);
+        max_x = std::max(max_x, pos_x[i]);
+        min_y = std::min(min_y, pos_y[i]);
+        max_y = std::max(max_y, pos_y[i]);
+        min_z = std::min(min_z, pos_z[i]);
+        max_z = std::max(max_z, pos_z[i]);
+    }
+    float half = 0.5f * std::max({max_x - min_x, max_y - min_y, max_z - min_z, 1.0e-6f}) * 1.001f;
+    float cx = 0.5f * (min_x + max_x), cy = 0.5f * (min_y + max_y), cz = 0.5f * (min_z + max_z);
+
+    // Morton keys of the bodies, quantised to 21 bits per axis inside the cube
+    keys.resize(n);
+    order.resize(n);
+    const float cells = (float) (1 << MORTON_BITS);
+    const float to_cell = cells / (2.0f * half);
+    workers().parallel_for(n, 16384, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            float fx = std::min((pos_x[i] - cx + half) * to_cell, cells - 1.0f);
+            float fy = std::min((pos_y[i] - cy + half) * to_cell, cells - 1.0f);
+            float fz = std::min((pos_z[i] - cz + half) * to_cell, cells - 1.0f);
+            keys[i] = spread_bits((uint64_t) std::max(fx, 0.0f)) << 2
+                      | spread_bits((uint64_t) std::max(fy, 0.0f)) << 1
+                      | spread_bits((uint64_t) std::max(fz, 0.0f));
+            order[i] = (uint32_t) i;
+        }
+    });
+    radix_sort(keys, order, keys_scratch, order_scratch);
+
+    // move the bodies into curve order so every cell covers a contiguous range of slots
+    float_scratch.resize(n);
+    auto permute = [this, n](aligned_vector<float> &column) {
+        for (size_t i = 0; i < n; i++)
+            float_scratch[i] = column[order[i]];
+        column.swap(float_scratch);
+    };
+    permute(pos_x);
+    permute(pos_y);
+    permute(pos_z);
+    permute(vel_x);
+    permute(vel_y);
+    permute(vel_z);
+    permute(mu);
+    id_scratch.resize(n);
+    for (size_t i = 0; i < n; i++)
+        id_scratch[i] = id[order[i]];
+    id.swap(id_scratch);
+    for (size_t i = 0; i < n; i++)
+        slot[id[i]] = (uint32_t) i;
+
+    nodes.clear();
+    leaves.clear();
+    nodes.push_back(Node());
+    nodes[0].begin = 0;
+    nodes[0].end = (int32_t) n;
+    fill_node(0, 0, cx, cy, cz, half);
+}
+
+void NBodySystem::fill_node(int32_t index, int level, float cx, float cy, float cz, float half) {
+    const int32_t begin = nodes[index].begin, end = nodes[index].end;
+    float com_x = 0.0f, com_y = 0.0f, com_z = 0.0f, total = 0.0f;
+
+    if (end - begin <= LEAF_SIZE || level == MORTON_BITS) {
+        for (int32_t i = begin; i < end; i++) {
+            com_x += mu[i] * pos_x[i];
+            com_y += mu[i] * pos_y[i];
+            com_z += mu[i] * pos_z[i];
+            total += mu[i];
+        }
+        nodes[index].first_child = -1;
+        nodes[index].child_count = 0;
+        leaves.push_back(index);
+    } else {
+        // keys are sorted, so each octant of this cell is a contiguous run of slots
+        const int shift = 3 * (MORTON_BITS - 1 - level);
+        int32_t ranges[9];
+        ranges[0] = begin;
+        for (int octant = 0; octant < 8; octant++) {
+            auto first = keys.begin() + ranges[octant], last = keys.begin() + end;
+            ranges[octant + 1] = (int32_t) (std::partition_point(first, last, [shift, octant](uint64_t key) {
+                return (int) ((key >> shift) & 7) <= octant;
+            }) - keys.begin());
+        }
+
+        const int32_t first_child = (int32_t) nodes.size();
+        int32_t child_count = 0;
+        for (int octant = 0; octant < 8; octant++) {
+            if (ranges[octant + 1] > ranges[octant]) {
+                Node child = Node();
+                child.begin = ranges[octant];
+                child.end = ranges[octant + 1];
+                nodes.push_back(child);
+                child_count++;
+            }
+        }
+        nodes[index].first_child = first_child;
+        nodes[index].child_count = child_count;
+
+        const float quarter = 0.5f * half;
+        int32_t child = first_child;
+        for (int octant = 0; octant < 8; octant++) {
+            if (ranges[octant + 1] == ranges[octant])
+                continue;
+            fill_node(child, level + 1,
+                      cx + ((octant & 4) ? quarter : -quarter),
+                      cy + ((octant & 2) ? quarter : -quarter),
+                      cz + ((octant & 1) ? quarter : -quarter), quarter);
+            const Node &filled = nodes[child];
+            com_x += filled.mu * filled.com_x;
+            com_y += filled.mu * filled.com_y;
+            com_z += filled.mu * filled.com_z;
+            total += filled.mu;
+            child++;
+        }
+    }
+
+    Node &node = nodes[index];
+    node.center_x = cx;
+    node.center_y = cy;
+    node.center_z = cz;
+    node.half = half;
+    node.mu = total;
+    float inv = total > 0.0f ? 1.0f / total : 0.0f;
+    node.com_x = total > 0.0f ? com_x * inv : cx;
+    node.com_y = total > 0.0f ? com_y * inv : cy;
+    node.com_z = total > 0.0f ? com_z * inv : cz;
+}
+
+// every leaf walks the tree once to gather the point masses acting on it, then all bodies
+// of the leaf sum that shared interaction list a full vector at a time
+void NBodySystem::compute_accelerations() {
+    const float theta2 = theta * theta;
+    const vfloat eps2 = v_set1(softening * softening);
+    const vfloat zero = v_set1(0.0f);
+    const vfloat one = v_set1(1.0f);
+
+    workers().parallel_for(leaves.size(), LEAF_GRAIN, [&](size_t first_leaf, size_t last_leaf) {
+        aligned_vector<float> list_x, list_y, list_z, list_mu;
+        int32_t stack[8 * (MORTON_BITS + 1)];
+
+        for (size_t l = first_leaf; l < last_leaf; l++) {
+            const Node &leaf = nodes[leaves[l]];
+
+            // box around the bodies of the leaf, the opening test uses the distance to it
+            float min_x = pos_x[leaf.begin], max_x = min_x;
+            float min_y = pos_y[leaf.begin], max_y = min_y;
+            float min_z = pos_z[leaf.begin], max_z = min_z;
+            for (int32_t i = leaf.begin + 1; i < leaf.end; i++) {
+                min_x = std::min(min_x, pos_x[i]);
+                max_x = std::max(max_x, pos_x[i]);
+                min_y = std::min(min_y, pos_y[i]);
+                max_y = std::max(max_y, pos_y[i]);
+                min_z = std::min(min_z, pos_z[i]);
+                max_z = std::max(max_z, pos_z[i]);
+            }
+
+            list_x.clear();
+            list_y.clear();
+            list_z.clear();
+            list_mu.clear();
+
+            int top = 0;
+            stack[top++] = 0;
+            while (top > 0) {
+                const Node &node = nodes[stack[--top]];
+                // a cell overlapping the leaf's box holds some of its bodies, which must not pull
+                // on themselves through the cell's mass, so it is opened whatever the angle
+                bool overlaps = min_x <= node.center_x + node.half && max_x >= node.center_x - node.half
+                                && min_y <= node.center_y + node.half && max_y >= node.center_y - node.half
+                                && min_z <= node.center_z + node.half && max_z >= node.center_z - node.half;
+                float dx = std::max({min_x - node.com_x, 0.0f, node.com_x - max_x});
+                float dy = std::max({min_y - node.com_y, 0.0f, node.com_y - max_y});
+                float dz = std::max({min_z - node.com_z, 0.0f, node.com_z - max_z});
+                float size = 2.0f * node.half;
+
+                if (!overlaps && size * size < theta2 * (dx * dx + dy * dy + dz * dz)) {
+                    // far enough from every body of the leaf to act as a single point mass
+                    list_x.push_back(node.com_x);
+                    list_y.push_back(node.com_y);
+                    list_z.push_back(node.com_z);
+                    list_mu.push_back(node.mu);
+                } else if (node.first_child < 0) {
+                    list_x.insert(list_x.end(), &pos_x[node.begin], &pos_x[0] + node.end);
+                    list_y.insert(list_y.end(), &pos_y[node.begin], &pos_y[0] + node.end);
+                    list_z.insert(list_z.end(), &pos_z[node.begin], &pos_z[0] + node.end);
+                    list_mu.insert(list_mu.end(), &mu[node.begin], &mu[0] + node.end);
+                } else {
+                    for (int32_t c = 0; c < node.child_count; c++)
+                        stack[top++] = node.first_child + c;
+                }
+            }
+
+            // massless padding up to a whole vector
+            while (list_mu.size() % SIMD_FLOAT_WIDTH != 0) {
+                list_x.push_back(0.0f);
+                list_y.push_back(0.0f);
+                list_z.push_back(0.0f);
+                list_mu.push_back(0.0f);
+            }
+
+            const size_t list_size = list_mu.size();
+            for (int32_t i = leaf.begin; i < leaf.end; i++) {
+                const vfloat x = v_set1(pos_x[i]), y = v_set1(pos_y[i]), z = v_set1(pos_z[i]);
+                vfloat ax = zero, ay = zero, az = zero;
+                for (size_t j = 0; j < list_size; j += SIMD_FLOAT_WIDTH) {
+                    vfloat dx = v_load(&list_x[j]) - x;
+                    vfloat dy = v_load(&list_y[j]) - y;
+                    vfloat dz = v_load(&list_z[j]) - z;
+                    vfloat r2 = v_fmadd(dx, dx, v_fmadd(dy, dy, v_fmadd(dz, dz, eps2)));
+                    // the body itself sits at distance zero and must not pull on itself
+                    vfloat inv = v_select(v_gt(r2, zero), one / v_sqrt(r2), zero);
+                    vfloat f = v_load(&list_mu[j]) * inv * inv * inv;
+                    ax = v_fmadd(f, dx, ax);
+                    ay = v_fmadd(f, dy, ay);
+                    az = v_fmadd(f, dz, az);
+                }
+                acc_x[i] = v_sum(ax);
+                acc_y[i] = v_sum(ay);
+                acc_z[i] = v_sum(az);
+            }
+        }
+    });
+}
+
+void NBodySystem::copy_positions(float *x, float *y, float *z) const {
+    const size_t n = mu.size();
+    for (size_t i = 0; i < n; i++) {
+        x[id[i]] = pos_x[i];
+        y[id[i]] = pos_y[i];
+        z[id[i]] = pos_z[i];
+    }
+}
+
+glm::vec3 NBodySystem::position(size_t body) const {
+    uint32_t s = slot[body];
+    return {pos_x[s], pos_y[s], pos_z[s]};
+}
@@ -0,0 +1,38 @@
+#include <render_queue.h>
+
+#include <algorithm>
+
+#include <glm/glm.hpp>
+
+uint64_t make_sort_key(uint32_t layer, uint32_t program, uint32_t mesh, uint32_t material, float depth) {
+    const uint64_t depth_steps = (1ull << SORT_KEY_DEPTH_BITS) - 1;
+    uint64_t quantized = (uint64_t) ((double) std::min(std::max(depth, 0.0f), 1.0f) * (double) depth_steps);
+    uint64_t key = layer & ((1u << SORT_KEY_LAYER_BITS) - 1);
+    key = (key << SORT_KEY_PROGRAM_BITS) | (program & ((1u << SORT_KEY_PROGRAM_BITS) - 1));
+    key = (key << SORT_KEY_MESH_BITS) | (mesh & ((1u << SORT_KEY_MESH_BITS) - 1));
+    key = (key << SORT_KEY_MATERIAL_BITS) | (material & ((1u << SORT_KEY_MATERIAL_BITS) - 1));
+    return (key << SORT_KEY_DEPTH_BITS) | quantized;
+}
+
+void RenderQueue::sort() {
+    radix_sort(commands, scratch, [](const DrawCommand &command) { return command.key; });
+}
+
+void RenderQueue::execute(GLStateCache &state) {
+    for (const DrawCommand &command: commands) {
+        state.use_program(command.program);
+        state.bind_vertex_array(command.vertex_array);
+        if (command.instance_buffer != 0) {
+            auto pointed = instance_offsets.find(command.vertex_array);
+            if (pointed == instance_offsets.end() || pointed->second != command.first_instance) {
+                state.bind_buffer(GL_ARRAY_BUFFER, command.instance_buffer);
+                size_t base = (size_t) command.first_instance * sizeof(glm::mat4);
+                for (GLuint column = 0; column < 4; column++)
+                    glVertexAttribPointer(command.instance_location + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                                          (void *) (base + column * sizeof(glm::vec4)));
+                instance_offsets[command.vertex_array] = command.first_instance;
+            }
+        }
+        glDrawArraysInstanced(GL_TRIANGLES, 0, command.vertex_count, (GLsizei) command.instance_count);
+    }
+}
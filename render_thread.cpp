@@ -0,0 +1,112 @@
+#include <render_thread.h>
+
+#include <algorithm>
+#include <chrono>
+
+// back-off of an idle side: the first retries only yield, then sleeps double up to the longest
+static const int WAIT_YIELDS = 64;
+static const std::chrono::microseconds WAIT_SLEEP_FIRST(50), WAIT_SLEEP_LONGEST(1000);
+
+// pop from 'queue', waiting while it is empty; false once it is empty and 'stopping' is set
+static bool pop_wait(SpscQueue<RenderFrame *> &queue, RenderFrame *&frame, const std::atomic<bool> *stopping) {
+    std::chrono::microseconds sleep = WAIT_SLEEP_FIRST;
+    for (int attempt = 0;; attempt++) {
+        // the flag is read before trying, so a frame pushed before it was set is still popped
+        bool last_try = stopping != NULL && stopping->load(std::memory_order_acquire);
+        if (queue.pop(frame))
+            return true;
+        if (last_try)
+            return false;
+        if (attempt < WAIT_YIELDS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(sleep);
+            sleep = std::min(sleep * 2, WAIT_SLEEP_LONGEST);
+        }
+    }
+}
+
+RenderThread::RenderThread() : frames(RENDER_FRAMES_IN_FLIGHT), filled(RENDER_FRAMES_IN_FLIGHT),
+                               drawn(RENDER_FRAMES_IN_FLIGHT) {
+    for (RenderFrame &frame: frames)
+        drawn.push(&frame);
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+bool RenderThread::start(SceneRenderer &renderer, bool software, uint32_t width, uint32_t height,
+                         const RenderContext &render_context, const FrameOutput &frame_output) {
+    stop();
+    stopping = false;
+    context = render_context;
+    output = frame_output;
+    std::promise<bool> started;
+    std::future<bool> result = started.get_future();
+    thread = std::thread(&RenderThread::run, this, std::ref(renderer), software, width, height, std::ref(started));
+    if (result.get())
+        return true;
+    thread.join();
+    return false;
+}
+
+RenderFrame *RenderThread::acquire() {
+    RenderFrame *frame = NULL;
+    pop_wait(drawn, frame, NULL);
+    frame->screenshot = false;
+    frame->presented = false;
+    frame->viewport_width = frame->viewport_height = 0;
+    return frame;
+}
+
+void RenderThread::submit(RenderFrame *frame) {
+    // every frame is either queued or held by one side, so neither queue can be full
+    filled.push(frame);
+}
+
+void RenderThread::stop() {
+    if (!thread.joinable())
+        return;
+    stopping.store(true, std::memory_order_release);
+    thread.join();
+}
+
+void RenderThread::run(SceneRenderer &renderer, bool software, uint32_t width, uint32_t height,
+                       std::promise<bool> &started) {
+    if (context.attach && !context.attach()) {
+        started.set_value(false);
+        return;
+    }
+    if (!renderer.init(software, width, height)) {
+        renderer.release();
+        if (context.detach)
+            context.detach();
+        started.set_value(false);
+        return;
+    }
+    started.set_value(true);
+
+    ScreenCapture capture;
+    RenderFrame *frame;
+    while (pop_wait(filled, frame, &stopping)) {
+        if (frame->viewport_width > 0 && frame->viewport_height > 0 && !renderer.is_software())
+            renderer.gl_state_cache().viewport(0, 0, frame->viewport_width, frame->viewport_height);
+        renderer.draw(frame->packet);
+        if (output)
+            output(renderer, capture, *frame);
+        if (context.present) {
+            context.present();
+            frame->presented = true;
+            frame->presented_at = std::chrono::steady_clock::now();
+        }
+        capture.poll();
+        frame->gl_stats = renderer.gl_frame_stats();
+        drawn.push(frame);
+    }
+
+    capture.release();
+    renderer.release();
+    if (context.detach)
+        context.detach();
+}
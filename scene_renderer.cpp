@@ -0,0 +1,230 @@
+#include <scene_renderer.h>
+
+#include <algorithm>
+
+// cube vertices: position and color, two triangles per face
+static const float CUBE_VERTICES[] = {
+        // back face, yellow
+        -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+        1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+        -1.0f, 1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+        -1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 0.0f,
+
+        // front face, purple
+        -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+        -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+        -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f,
+
+        // right face, green
+        1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+
+        // left face, red
+        -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+        -1.0f, 1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
+        -1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
+        -1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 0.0f,
+        -1.0f, -1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+        -1.0f, 1.0f, 1.0f, 1.0f, 0.0f, 0.0f,
+
+        // bottom face, light blue
+        -1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+        1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+        1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+        1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+        -1.0f, -1.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+        -1.0f, -1.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+
+        // top face, blue
+        -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+        1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+        -1.0f, 1.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+        -1.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+};
+
+static const size_t CUBE_VERTEX_COUNT = sizeof(CUBE_VERTICES) / (6 * sizeof(float));
+
+SceneRenderer::~SceneRenderer() {
+    release();
+}
+
+bool SceneRenderer::init(bool software, uint32_t width, uint32_t height, size_t raster_threads,
+                         InstanceTransform transform) {
+    release();
+    frame_width = width;
+    frame_height = height;
+    if (software) {
+        software_raster.reset(new SoftRasterizer(raster_threads));
+        software_raster->resize(width, height);
+        return true;
+    }
+
+    // configure global openGL state
+    gl_state.invalidate();
+    gl_state.set_enabled(GL_DEPTH_TEST, true);
+    gl_state.depth_func(GL_LESS);
+//    gl_state.set_enabled(GL_CULL_FACE, true);
+//    gl_state.cull_face(GL_BACK);
+
+    // build and compile shader program
+    instance_transform = transform;
+    shaders.reset(new ShaderVariants("shaders/shader.vs", "shaders/shader.fs", shader_cache.c_str()));
+    shader_defines.clear();
+    if (transform == InstanceTransform::ModelViewProjection)
+        shader_defines.push_back("INSTANCE_MVP");
+    select_program();
+    if (hot_reload) {
+        shader_watcher.reset(new FileWatcher());
+        watch_shader_sources();
+    }
+
+    // per-frame uniforms live at a fixed binding point; programs that use the block point at it
+    glGenBuffers(1, &frame_UBO);
+    gl_state.bind_buffer(GL_UNIFORM_BUFFER, frame_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_STREAM_DRAW);
+    gl_state.bind_buffer_base(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frame_UBO);
+
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &VBO);
+
+    // bind Vertex Array Object
+    gl_state.bind_vertex_array(VAO);
+
+    // bind vertices array to a vertex buffer
+    gl_state.bind_buffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
+
+    // position attribute
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) 0);
+    glEnableVertexAttribArray(0);
+
+    // color attribute
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) (3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    // instance matrix attribute, one column per location, advancing once per instance
+    glGenBuffers(1, &instance_VBO);
+    gl_state.bind_buffer(GL_ARRAY_BUFFER, instance_VBO);
+    for (GLuint column = 0; column < 4; column++) {
+        glVertexAttribPointer(2 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4),
+                              (void *) (column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(2 + column);
+        glVertexAttribDivisor(2 + column, 1);
+    }
+    return true;
+}
+
+void SceneRenderer::release() {
+    if (shader) {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &instance_VBO);
+        glDeleteBuffers(1, &frame_UBO);
+        shaders->release();
+    }
+    shaders.reset();
+    shader = nullptr;
+    shader_watcher.reset();
+    gl_state.invalidate();
+    render_queue.invalidate();
+    software_raster.reset();
+    VAO = VBO = instance_VBO = frame_UBO = 0;
+}
+
+void SceneRenderer::draw(const BodyRegistry &bodies, int32_t focus) {
+    // a single chunk keeps the whole frame in one front-to-back order
+    record_frame(bodies, focus, camera, aspect(), packet_transform(), own_packet, NULL,
+                 std::max<size_t>(bodies.size(), 1));
+    draw(own_packet);
+}
+
+void SceneRenderer::draw(const FramePacket &packet) {
+    if (software_raster) {
+        software_raster->clear(0.3f, 0.4f, 0.5f);
+        for (const DrawCommand &command: packet.commands)
+            software_raster->draw_instanced(CUBE_VERTICES, CUBE_VERTEX_COUNT, packet.view, packet.projection,
+                                            packet.instances.data() + command.first_instance, command.instance_count);
+        return;
+    }
+
+    last_frame_gl = gl_state.end_frame();
+
+    // background color
+    glClearColor(0.3f, 0.4f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // edited shaders are rebuilt in the background and swapped in once linked, never waited for
+    if (shader_watcher && shader_watcher->poll())
+        shaders->reload();
+    if (shaders->poll()) {
+        select_program();
+        watch_shader_sources();
+    }
+
+    FrameUniforms frame;
+    frame.view_projection = packet.projection * packet.view;
+    frame.view = packet.view;
+    frame.projection = packet.projection;
+    frame.camera_position = glm::vec4(packet.eye, 1.0f);
+    frame.time = packet.time;
+    gl_state.bind_buffer(GL_UNIFORM_BUFFER, frame_UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), &frame, GL_STREAM_DRAW);
+
+    // stream this frame's instance matrices into fresh storage, so the upload never waits for
+    // the previous frame's draw to finish reading the old contents
+    gl_state.bind_buffer(GL_ARRAY_BUFFER, instance_VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (packet.instances.size() * sizeof(glm::mat4)), packet.instances.data(),
+                 GL_STREAM_DRAW);
+
+    // every chunk is one instance range of the cube mesh
+    render_queue.clear();
+    for (DrawCommand command: packet.commands) {
+        command.program = shader->ID;
+        command.vertex_array = VAO;
+        command.vertex_count = (GLsizei) CUBE_VERTEX_COUNT;
+        command.instance_buffer = instance_VBO;
+        command.instance_location = 2;
+        render_queue.submit(command);
+    }
+    render_queue.sort();
+    render_queue.execute(gl_state);
+}
+
+bool SceneRenderer::capture(ScreenCapture &capture, const CaptureSink &sink, bool wait_when_full) {
+    if (software_raster) {
+        sink(software_raster->pixels(), frame_width, frame_height);
+        return true;
+    }
+    // the capture binds pixel pack buffers in this renderer's context, so the cache has to see them
+    capture.use_state_cache(&gl_state);
+    return capture.capture(frame_width, frame_height, sink, wait_when_full);
+}
+
+void SceneRenderer::select_program() {
+    shader = &shaders->get(shader_defines);
+    GLuint block = shader->uniformBlock("FrameUniforms");
+    if (block != GL_INVALID_INDEX)
+        glUniformBlockBinding(shader->ID, block, FRAME_UNIFORM_BINDING);
+}
+
+void SceneRenderer::watch_shader_sources() {
+    if (!shader_watcher)
+        return;
+    // sources that come from the executable cannot change
+    for (const std::string &source: shaders->sourceFiles()) {
+        std::string file = asset_file(source);
+        if (!file.empty())
+            shader_watcher->watch(file);
+    }
+}
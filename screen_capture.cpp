@@ -0,0 +1,91 @@
+#include <screen_capture.h>
+
+#include <algorithm>
+#include <iostream>
+
+ScreenCapture::ScreenCapture(size_t ring_size) : slots(std::max<size_t>(ring_size, 1)) {}
+
+bool ScreenCapture::capture(uint32_t width, uint32_t height, CaptureSink sink, bool wait_when_full) {
+    if (pending.size() == slots.size()) {
+        if (!wait_when_full)
+            return false;
+        Slot &oldest = slots[pending.front()];
+        glClientWaitSync(oldest.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        hand_over(oldest);
+        pending.pop_front();
+    }
+    // the slots are used round robin, so the next free one follows the newest in flight
+    size_t index = pending.empty() ? 0 : (pending.back() + 1) % slots.size();
+    Slot &slot = slots[index];
+
+    // RGBA rows are always 4-byte aligned and match what the driver keeps, so the copy stays on the GPU
+    size_t bytes = (size_t) width * height * 4;
+    if (slot.buffer == 0)
+        glGenBuffers(1, &slot.buffer);
+    bind_pack_buffer(slot.buffer);
+    if (slot.capacity != bytes) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) bytes, NULL, GL_STREAM_READ);
+        slot.capacity = bytes;
+    }
+    glReadPixels(0, 0, (GLsizei) width, (GLsizei) height, GL_RGBA, GL_UNSIGNED_BYTE, (void *) 0);
+    bind_pack_buffer(0);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.sink = std::move(sink);
+    pending.push_back(index);
+    return true;
+}
+
+void ScreenCapture::poll() {
+    while (!pending.empty()) {
+        Slot &slot = slots[pending.front()];
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        hand_over(slot);
+        pending.pop_front();
+    }
+}
+
+void ScreenCapture::finish() {
+    while (!pending.empty()) {
+        Slot &slot = slots[pending.front()];
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        hand_over(slot);
+        pending.pop_front();
+    }
+}
+
+void ScreenCapture::release() {
+    finish();
+    for (Slot &slot: slots) {
+        if (slot.buffer != 0)
+            glDeleteBuffers(1, &slot.buffer);
+        slot = Slot();
+    }
+}
+
+void ScreenCapture::hand_over(Slot &slot) {
+    glDeleteSync(slot.fence);
+    slot.fence = NULL;
+
+    bind_pack_buffer(slot.buffer);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) slot.capacity, GL_MAP_READ_BIT);
+    if (mapped != NULL) {
+        slot.sink((const uint8_t *) mapped, slot.width, slot.height);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else {
+        std::cout << "ERROR::SCREEN_CAPTURE::BUFFER_NOT_MAPPED" << std::endl;
+    }
+    bind_pack_buffer(0);
+    slot.sink = CaptureSink();
+}
+
+void ScreenCapture::bind_pack_buffer(GLuint buffer) {
+    if (state_cache)
+        state_cache->bind_buffer(GL_PIXEL_PACK_BUFFER, buffer);
+    else
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+}
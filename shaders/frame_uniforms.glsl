@@ -0,0 +1,9 @@
+// per-frame values shared by every program, updated once per frame (std140, binding point 0)
+layout (std140) uniform FrameUniforms
+{
+    mat4 viewProjection;
+    mat4 view;
+    mat4 projection;
+    vec4 cameraPosition;
+    float time; // simulation days
+};
\ No newline at end of file
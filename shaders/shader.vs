@@ -1,15 +1,23 @@
 #version 330 core
+// variants: INSTANCE_MVP takes projection * view * model per instance instead of the model matrix
 layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
 layout (location = 1) in vec3 aColor; // the color variable has attribute position 1
+#ifdef INSTANCE_MVP
+layout (location = 2) in mat4 aMVP;   // per-instance projection * view * model, columns at locations 2 to 5
+#else
+layout (location = 2) in mat4 aModel; // per-instance model matrix, one column per location 2 to 5
+#endif
 
 out vec3 fragColor; // output a color to the fragment shader
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "frame_uniforms.glsl"
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef INSTANCE_MVP
+    gl_Position = aMVP * vec4(aPos, 1.0);
+#else
+    gl_Position = viewProjection * (aModel * vec4(aPos, 1.0));
+#endif
     fragColor = aColor; // set fragColor to the input color we got from the vertex data
 }
\ No newline at end of file
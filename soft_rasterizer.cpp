@@ -0,0 +1,345 @@
+#include <soft_rasterizer.h>
+#include <simd_float.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+static const int32_t TILE_SIZE = 64;
+static const int32_t BLOCK_SIZE = 8;
+// instance chunks per pool thread, so setup stays balanced when instances differ in cost
+static const size_t CHUNKS_PER_THREAD = 4;
+
+alignas(32) static const float LANE_OFFSETS[8] = {0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f};
+
+static float edge_at(const float *a, const float *b, const float *c, int e, float dx, float dy) {
+    return a[e] * dx + b[e] * dy + c[e];
+}
+
+static uint8_t to_unorm8(float c) {
+    return (uint8_t) (std::min(std::max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+SoftRasterizer::SoftRasterizer(size_t threads) : pool(threads) {}
+
+void SoftRasterizer::resize(uint32_t width, uint32_t height) {
+    frame_width = width;
+    frame_height = height;
+    tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+    blocks_x = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blocks_y = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    depth_stride = (size_t) blocks_x * BLOCK_SIZE;
+    color.assign((size_t) width * height * 4, 0);
+    depth.assign(depth_stride * blocks_y * BLOCK_SIZE, 1.0f);
+    block_far.assign((size_t) blocks_x * blocks_y, 1.0f);
+}
+
+void SoftRasterizer::clear(float r, float g, float b) {
+    const uint8_t rgba[4] = {to_unorm8(r), to_unorm8(g), to_unorm8(b), 255};
+    pool.parallel_for(blocks_y, 8, [this, &rgba](size_t begin, size_t end) {
+        for (size_t block_row = begin; block_row < end; block_row++) {
+            size_t y_end = std::min<size_t>((block_row + 1) * BLOCK_SIZE, frame_height);
+            for (size_t y = block_row * BLOCK_SIZE; y < y_end; y++) {
+                uint8_t *row = &color[y * frame_width * 4];
+                for (size_t x = 0; x < frame_width; x++)
+                    std::memcpy(row + 4 * x, rgba, 4);
+            }
+            float *depth_rows = &depth[block_row * BLOCK_SIZE * depth_stride];
+            std::fill(depth_rows, depth_rows + BLOCK_SIZE * depth_stride, 1.0f);
+            std::fill(&block_far[block_row * blocks_x], &block_far[block_row * blocks_x] + blocks_x, 1.0f);
+        }
+    });
+}
+
+void SoftRasterizer::draw_instanced(const float *vertices, size_t vertex_count, const glm::mat4 &view,
+                                    const glm::mat4 &projection, const glm::mat4 *models, size_t instance_count) {
+    if (instance_count == 0 || vertex_count < 3 || frame_width == 0 || frame_height == 0)
+        return;
+
+    // setup: every chunk of instances is transformed, clipped and binned on its own
+    const glm::mat4 view_projection = projection * view;
+    const size_t wanted = pool.size() * CHUNKS_PER_THREAD;
+    const size_t grain = (instance_count + wanted - 1) / wanted;
+    const size_t chunk_count = (instance_count + grain - 1) / grain;
+    const size_t tile_count = (size_t) tiles_x * tiles_y;
+    if (chunks.size() < chunk_count)
+        chunks.resize(chunk_count);
+    pool.parallel_for(instance_count, grain, [&](size_t begin, size_t end) {
+        Chunk &chunk = chunks[begin / grain];
+        chunk.triangles.clear();
+        chunk.bins.resize(tile_count);
+        for (std::vector<uint32_t> &bin: chunk.bins)
+            bin.clear();
+        setup_instances(chunk, vertices, vertex_count, view_projection, models, begin, end);
+    });
+
+    // raster: tiles own disjoint pixels and walk the chunks in instance order
+    pool.parallel_for(tile_count, 1, [this, chunk_count](size_t begin, size_t end) {
+        for (size_t tile = begin; tile < end; tile++)
+            rasterize_tile(tile, chunk_count);
+    });
+}
+
+void SoftRasterizer::setup_instances(Chunk &chunk, const float *vertices, size_t vertex_count,
+                                     const glm::mat4 &view_projection, const glm::mat4 *models, size_t begin,
+                                     size_t end) {
+    const size_t triangle_count = vertex_count / 3;
+    std::vector<glm::vec4> clip(vertex_count);
+    std::vector<glm::vec3> rgb(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++)
+        rgb[v] = glm::vec3(vertices[6 * v + 3], vertices[6 * v + 4], vertices[6 * v + 5]);
+
+    for (size_t i = begin; i < end; i++) {
+        const glm::mat4 mvp = view_projection * models[i];
+        for (size_t v = 0; v < vertex_count; v++)
+            clip[v] = mvp * glm::vec4(vertices[6 * v], vertices[6 * v + 1], vertices[6 * v + 2], 1.0f);
+        for (size_t k = 0; k < triangle_count; k++)
+            clip_triangle(chunk, &clip[3 * k], &rgb[3 * k]);
+    }
+}
+
+void SoftRasterizer::clip_triangle(Chunk &chunk, const glm::vec4 *clip, const glm::vec3 *rgb) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w)
+            return;
+        if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w)
+            return;
+    }
+
+    float distance[3];
+    bool in_front = true;
+    for (int i = 0; i < 3; i++) {
+        distance[i] = clip[i].z + clip[i].w;
+        in_front = in_front && distance[i] >= 0.0f;
+    }
+    if (in_front) {
+        bin_triangle(chunk, clip, rgb);
+        return;
+    }
+
+    // one vertex behind the near plane leaves a quad, two leave a triangle
+    glm::vec4 poly_clip[4];
+    glm::vec3 poly_rgb[4];
+    int n = 0;
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        if (distance[i] >= 0.0f) {
+            poly_clip[n] = clip[i];
+            poly_rgb[n++] = rgb[i];
+        }
+        if ((distance[i] >= 0.0f) != (distance[j] >= 0.0f)) {
+            float t = distance[i] / (distance[i] - distance[j]);
+            poly_clip[n] = glm::mix(clip[i], clip[j], t);
+            poly_rgb[n++] = glm::mix(rgb[i], rgb[j], t);
+        }
+    }
+    if (n >= 3)
+        bin_triangle(chunk, poly_clip, poly_rgb);
+    if (n == 4) {
+        glm::vec4 second_clip[3] = {poly_clip[0], poly_clip[2], poly_clip[3]};
+        glm::vec3 second_rgb[3] = {poly_rgb[0], poly_rgb[2], poly_rgb[3]};
+        bin_triangle(chunk, second_clip, second_rgb);
+    }
+}
+
+void SoftRasterizer::bin_triangle(Chunk &chunk, const glm::vec4 *clip, const glm::vec3 *rgb) {
+    // window coordinates, y up and pixel centers at half integers like GL
+    float sx[3], sy[3], sz[3], inv_w[3];
+    for (int i = 0; i < 3; i++) {
+        inv_w[i] = 1.0f / clip[i].w;
+        sx[i] = (clip[i].x * inv_w[i] * 0.5f + 0.5f) * (float) frame_width;
+        sy[i] = (clip[i].y * inv_w[i] * 0.5f + 0.5f) * (float) frame_height;
+        sz[i] = clip[i].z * inv_w[i] * 0.5f + 0.5f;
+    }
+
+    // both windings are drawn, clockwise ones are flipped to counter-clockwise
+    float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+    if (!(area != 0.0f) || !std::isfinite(area))
+        return;
+    int v[3] = {0, 1, 2};
+    if (area < 0.0f) {
+        std::swap(v[1], v[2]);
+        area = -area;
+    }
+
+    float lo_x = std::min({sx[0], sx[1], sx[2]}), hi_x = std::max({sx[0], sx[1], sx[2]});
+    float lo_y = std::min({sy[0], sy[1], sy[2]}), hi_y = std::max({sy[0], sy[1], sy[2]});
+    Triangle t;
+    t.min_x = std::max((int32_t) std::ceil(std::max(lo_x, -1.0f) - 0.5f), 0);
+    t.min_y = std::max((int32_t) std::ceil(std::max(lo_y, -1.0f) - 0.5f), 0);
+    t.max_x = std::min((int32_t) std::floor(std::min(hi_x, (float) frame_width + 1.0f) - 0.5f),
+                       (int32_t) frame_width - 1);
+    t.max_y = std::min((int32_t) std::floor(std::min(hi_y, (float) frame_height + 1.0f) - 0.5f),
+                       (int32_t) frame_height - 1);
+    if (t.min_x > t.max_x || t.min_y > t.max_y)
+        return;
+
+    // edge e runs from vertex e + 1 to vertex e + 2 and is positive on the triangle's side
+    t.x0 = sx[v[0]];
+    t.y0 = sy[v[0]];
+    for (int e = 0; e < 3; e++) {
+        int from = v[(e + 1) % 3], to = v[(e + 2) % 3];
+        t.edge_a[e] = sy[from] - sy[to];
+        t.edge_b[e] = sx[to] - sx[from];
+        t.edge_c[e] = t.edge_a[e] * (t.x0 - sx[from]) + t.edge_b[e] * (t.y0 - sy[from]);
+        // a pixel center right on an edge belongs to the triangle on its top or left side
+        bool top_left = t.edge_a[e] > 0.0f || (t.edge_a[e] == 0.0f && t.edge_b[e] < 0.0f);
+        t.edge_min[e] = top_left ? -std::numeric_limits<float>::denorm_min() : 0.0f;
+    }
+
+    // the edge functions opposite each vertex are its unnormalized barycentric weights
+    auto plane = [&t, &v, area](const float *f, float *out) {
+        out[0] = f[v[0]];
+        out[1] = (t.edge_a[0] * f[v[0]] + t.edge_a[1] * f[v[1]] + t.edge_a[2] * f[v[2]]) / area;
+        out[2] = (t.edge_b[0] * f[v[0]] + t.edge_b[1] * f[v[1]] + t.edge_b[2] * f[v[2]]) / area;
+    };
+    float r[3], g[3], b[3];
+    for (int i = 0; i < 3; i++) {
+        r[i] = rgb[i].r * inv_w[i];
+        g[i] = rgb[i].g * inv_w[i];
+        b[i] = rgb[i].b * inv_w[i];
+    }
+    plane(sz, t.z);
+    plane(inv_w, t.inv_w);
+    plane(r, t.r);
+    plane(g, t.g);
+    plane(b, t.b);
+    t.z_min = std::min({sz[0], sz[1], sz[2]});
+    t.z_max = std::max({sz[0], sz[1], sz[2]});
+
+    // bin into every tile of the bounds that the edges do not rule out
+    const uint32_t index = (uint32_t) chunk.triangles.size();
+    chunk.triangles.push_back(t);
+    const int32_t tile_x0 = t.min_x / TILE_SIZE, tile_x1 = t.max_x / TILE_SIZE;
+    const int32_t tile_y0 = t.min_y / TILE_SIZE, tile_y1 = t.max_y / TILE_SIZE;
+    const bool single = tile_x0 == tile_x1 && tile_y0 == tile_y1;
+    for (int32_t ty = tile_y0; ty <= tile_y1; ty++) {
+        for (int32_t tx = tile_x0; tx <= tile_x1; tx++) {
+            bool outside = false;
+            for (int e = 0; e < 3 && !single && !outside; e++) {
+                // the largest value over the tile sits at the corner the edge's gradient points to
+                int32_t x = t.edge_a[e] > 0.0f ? std::min(tx * TILE_SIZE + TILE_SIZE - 1, t.max_x) : tx * TILE_SIZE;
+                int32_t y = t.edge_b[e] > 0.0f ? std::min(ty * TILE_SIZE + TILE_SIZE - 1, t.max_y) : ty * TILE_SIZE;
+                outside = edge_at(t.edge_a, t.edge_b, t.edge_c, e, (float) x + 0.5f - t.x0,
+                                  (float) y + 0.5f - t.y0) <= t.edge_min[e];
+            }
+            if (!outside)
+                chunk.bins[(size_t) ty * tiles_x + tx].push_back(index);
+        }
+    }
+}
+
+void SoftRasterizer::rasterize_tile(size_t tile, size_t chunk_count) {
+    const int32_t tile_x = (int32_t) (tile % tiles_x) * TILE_SIZE;
+    const int32_t tile_y = (int32_t) (tile / tiles_x) * TILE_SIZE;
+    const int32_t tile_x_end = std::min(tile_x + TILE_SIZE, (int32_t) frame_width) - 1;
+    const int32_t tile_y_end = std::min(tile_y + TILE_SIZE, (int32_t) frame_height) - 1;
+
+    // depth is resolved first, remembering the triangle that owns each pixel; colors are only
+    // evaluated for the winners at the end, so overdraw costs a depth test and no shading
+    const Triangle *owner[TILE_SIZE * TILE_SIZE] = {};
+    bool drawn = false;
+    for (size_t c = 0; c < chunk_count; c++) {
+        const Chunk &chunk = chunks[c];
+        for (uint32_t index: chunk.bins[tile]) {
+            const Triangle &t = chunk.triangles[index];
+            const int32_t x0 = std::max(t.min_x, tile_x) / BLOCK_SIZE * BLOCK_SIZE;
+            const int32_t y0 = std::max(t.min_y, tile_y) / BLOCK_SIZE * BLOCK_SIZE;
+            const int32_t x1 = std::min(t.max_x, tile_x_end), y1 = std::min(t.max_y, tile_y_end);
+            for (int32_t by = y0; by <= y1; by += BLOCK_SIZE) {
+                for (int32_t bx = x0; bx <= x1; bx += BLOCK_SIZE) {
+                    // nothing in the block can pass when the triangle's nearest point is behind all of it
+                    float &block_depth = block_far[(size_t) (by / BLOCK_SIZE) * blocks_x + bx / BLOCK_SIZE];
+                    if (t.z_min >= block_depth)
+                        continue;
+
+                    // edges are linear, so their extremes over the block are at the corner pixels
+                    const float dx_lo = (float) bx + 0.5f - t.x0, dx_hi = dx_lo + (float) (BLOCK_SIZE - 1);
+                    const float dy_lo = (float) by + 0.5f - t.y0, dy_hi = dy_lo + (float) (BLOCK_SIZE - 1);
+                    bool outside = false, covered = true;
+                    for (int e = 0; e < 3 && !outside; e++) {
+                        bool a_up = t.edge_a[e] > 0.0f, b_up = t.edge_b[e] > 0.0f;
+                        float high = edge_at(t.edge_a, t.edge_b, t.edge_c, e, a_up ? dx_hi : dx_lo,
+                                             b_up ? dy_hi : dy_lo);
+                        float low = edge_at(t.edge_a, t.edge_b, t.edge_c, e, a_up ? dx_lo : dx_hi,
+                                            b_up ? dy_lo : dy_hi);
+                        outside = high <= t.edge_min[e];
+                        covered = covered && low > t.edge_min[e];
+                    }
+                    if (outside)
+                        continue;
+                    rasterize_block(t, bx, by, covered, &owner[(by - tile_y) * TILE_SIZE + bx - tile_x]);
+                    drawn = true;
+
+                    // a block the triangle covers ends up no farther than the triangle's farthest point in it
+                    if (covered && bx + BLOCK_SIZE <= (int32_t) frame_width &&
+                        by + BLOCK_SIZE <= (int32_t) frame_height) {
+                        float z_far = t.z[0] + std::max(t.z[1] * dx_lo, t.z[1] * dx_hi) +
+                                      std::max(t.z[2] * dy_lo, t.z[2] * dy_hi);
+                        block_depth = std::min(block_depth, std::min(z_far, t.z_max));
+                    }
+                }
+            }
+        }
+    }
+
+    if (!drawn)
+        return;
+    for (int32_t y = tile_y; y <= tile_y_end; y++) {
+        const Triangle *const *row_owner = &owner[(y - tile_y) * TILE_SIZE];
+        uint8_t *color_row = &color[(size_t) y * frame_width * 4];
+        const float dy_center = (float) y + 0.5f;
+        for (int32_t x = tile_x; x <= tile_x_end; x++) {
+            const Triangle *t = row_owner[x - tile_x];
+            if (!t)
+                continue;
+            float dx = (float) x + 0.5f - t->x0, dy = dy_center - t->y0;
+            float w = 1.0f / (t->inv_w[0] + t->inv_w[1] * dx + t->inv_w[2] * dy);
+            uint8_t *px = color_row + 4 * x;
+            px[0] = to_unorm8((t->r[0] + t->r[1] * dx + t->r[2] * dy) * w);
+            px[1] = to_unorm8((t->g[0] + t->g[1] * dx + t->g[2] * dy) * w);
+            px[2] = to_unorm8((t->b[0] + t->b[1] * dx + t->b[2] * dy) * w);
+            px[3] = 255;
+        }
+    }
+}
+
+void SoftRasterizer::rasterize_block(const Triangle &t, int32_t bx, int32_t by, bool covered,
+                                     const Triangle **owner) {
+    const vfloat lanes = v_load(LANE_OFFSETS);
+    const int32_t rows = std::min(BLOCK_SIZE, (int32_t) frame_height - by);
+    const int32_t columns = std::min(BLOCK_SIZE, (int32_t) frame_width - bx);
+    const float dx0 = (float) bx + 0.5f - t.x0;
+
+    for (int32_t row = 0; row < rows; row++) {
+        const float dy = (float) (by + row) + 0.5f - t.y0;
+        float *depth_row = &depth[(size_t) (by + row) * depth_stride + bx];
+        const Triangle **row_owner = owner + row * TILE_SIZE;
+
+        for (int32_t x = 0; x < columns; x += SIMD_FLOAT_WIDTH) {
+            vfloat dx = v_set1(dx0 + (float) x) + lanes;
+            vfloat z = v_fmadd(v_set1(t.z[1]), dx, v_set1(t.z[0] + t.z[2] * dy));
+            vfloat old = v_load(depth_row + x);
+            vmask pass = v_lt(z, old);
+            if (!covered) {
+                for (int e = 0; e < 3; e++) {
+                    vfloat edge = v_fmadd(v_set1(t.edge_a[e]), dx, v_set1(t.edge_b[e] * dy + t.edge_c[e]));
+                    pass = v_and(pass, v_gt(edge, v_set1(t.edge_min[e])));
+                }
+            }
+            int bits = v_mask_bits(pass);
+            if (columns - x < SIMD_FLOAT_WIDTH)
+                bits &= (1 << (columns - x)) - 1;
+            if (bits == 0)
+                continue;
+            // lanes past the frame's right edge land in the padding of the depth rows
+            v_store(depth_row + x, v_select(pass, z, old));
+
+            for (int lane = 0; lane < SIMD_FLOAT_WIDTH; lane++)
+                if (bits >> lane & 1)
+                    row_owner[x + lane] = &t;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#include <solar_system.h>
+
+#include <cmath>
+#include <random>
+
+const float SUN_EARTH_DISTANCE = 24.0f;
+const float EARTH_MOON_DISTANCE = 12.0f;
+const float SUN_REVOLVE_DAYS = 27.0f;
+const float EARTH_REVOLVE_DAYS = 1.0f;
+const float EARTH_ORBIT_DAYS = 365.0f;
+const float MOON_REVOLVE_DAYS = 28.0f;
+const float MOON_ORBIT_DAYS = 28.0f;
+const float EARTH_TILT_DEGREES = 23.4f;
+const double KM_PER_AU = 149597870.7;
+const double EARTH_MOON_KM = 384400.0;
+
+int32_t build_solar_system(BodyRegistry &bodies) {
+    int32_t sun = bodies.add_body({-1, 0.0f, 0.0f, SUN_REVOLVE_DAYS, 0.0f, 6.0f});
+    int32_t earth = bodies.add_body({sun, SUN_EARTH_DISTANCE, EARTH_ORBIT_DAYS, EARTH_REVOLVE_DAYS, EARTH_TILT_DEGREES, 3.0f});
+    return bodies.add_body({earth, EARTH_MOON_DISTANCE, MOON_ORBIT_DAYS, MOON_REVOLVE_DAYS, 0.0f, 1.5f});
+}
+
+int32_t build_nbody_system(BodyRegistry &bodies, NBodySystem &nbody, size_t asteroid_count) {
+    // gravitational parameter that gives the earth its orbit period at its distance
+    const float two_pi = 6.28318530717958647692f;
+    const float sun_mu = two_pi * two_pi * SUN_EARTH_DISTANCE * SUN_EARTH_DISTANCE * SUN_EARTH_DISTANCE
+                         / (EARTH_ORBIT_DAYS * EARTH_ORBIT_DAYS);
+    auto circular_velocity = [sun_mu](const glm::vec3 &pos) {
+        float r = glm::length(glm::vec3(pos.x, 0.0f, pos.z));
+        // prograde in the same sense as BodyRegistry orbits
+        return std::sqrt(sun_mu / r) * glm::vec3(pos.z, 0.0f, -pos.x) / r;
+    };
+
+    nbody.reserve(asteroid_count + 2);
+    bodies.reserve(asteroid_count + 2);
+
+    int32_t sun = bodies.add_body({-1, 0.0f, 0.0f, SUN_REVOLVE_DAYS, 0.0f, 6.0f});
+    nbody.add_body(glm::vec3(0.0f), glm::vec3(0.0f), sun_mu);
+
+    glm::vec3 earth_pos(SUN_EARTH_DISTANCE, 0.0f, 0.0f);
+    bodies.add_body({sun, 0.0f, 0.0f, EARTH_REVOLVE_DAYS, EARTH_TILT_DEGREES, 3.0f});
+    nbody.add_body(earth_pos, circular_velocity(earth_pos), sun_mu * 3.0e-6f);
+
+    // a thin disc of asteroids holding a percent of the sun's mass between them
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const float asteroid_mu = sun_mu * 0.01f / (float) asteroid_count;
+    for (size_t i = 0; i < asteroid_count; i++) {
+        float radius = 1.25f * SUN_EARTH_DISTANCE + 2.5f * SUN_EARTH_DISTANCE * unit(rng);
+        float angle = two_pi * unit(rng);
+        glm::vec3 pos(radius * std::cos(angle), 2.0f * unit(rng) - 1.0f, -radius * std::sin(angle));
+        bodies.add_body({sun, 0.0f, 0.0f, 0.5f + 5.0f * unit(rng), 90.0f * unit(rng), 0.3f});
+        nbody.add_body(pos, circular_velocity(pos), asteroid_mu);
+    }
+    return sun;
+}
+
+bool spk_solar_system_positions(SpkKernel &kernel, SimTick tick, float *x, float *y, float *z) {
+    double et = sim_days(tick) * 86400.0;
+    glm::dvec3 earth, moon;
+    if (!kernel.position(NAIF_EARTH, NAIF_SUN, et, earth) || !kernel.position(NAIF_MOON, NAIF_EARTH, et, moon))
+        return false;
+
+    // ecliptic coordinates map to scene axes as (x, z, -y)
+    earth *= SUN_EARTH_DISTANCE / KM_PER_AU;
+    moon *= EARTH_MOON_DISTANCE / EARTH_MOON_KM;
+    x[0] = y[0] = z[0] = 0.0f;
+    x[1] = (float) earth.x;
+    y[1] = (float) earth.z;
+    z[1] = (float) -earth.y;
+    x[2] = (float) (earth.x + moon.x);
+    y[2] = (float) (earth.z + moon.z);
+    z[2] = (float) -(earth.y + moon.y);
+    return true;
+}
@@ -0,0 +1,290 @@
+#include <spk.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const size_t DAF_RECORD_BYTES = 1024;
+static const int32_t FRAME_J2000 = 1;
+// obliquity of the ecliptic at J2000, rotates equatorial coordinates into the ecliptic
+static const double J2000_OBLIQUITY = 0.40909280422232897;
+
+static bool host_is_little_endian() {
+    const uint16_t probe = 1;
+    unsigned char first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// ECLIPJ2000 (17) segments are already in the ecliptic and pass through unchanged
+static glm::dvec3 to_ecliptic(int32_t frame, const glm::dvec3 &v) {
+    if (frame != FRAME_J2000)
+        return v;
+    double c = std::cos(J2000_OBLIQUITY), s = std::sin(J2000_OBLIQUITY);
+    return {v.x, c * v.y + s * v.z, -s * v.y + c * v.z};
+}
+
+bool SpkKernel::open(const std::string &path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cout << "ERROR::SPK::FILE_NOT_SUCCESSFULLY_OPENED: " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (view == NULL) {
+        std::cout << "ERROR::SPK::FILE_NOT_MAPPED: " << path << std::endl;
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_handle = file;
+    mapping_handle = mapping;
+    data = (const unsigned char *) view;
+    size = (size_t) file_size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        std::cout << "ERROR::SPK::FILE_NOT_SUCCESSFULLY_OPENED: " << path << std::endl;
+        if (fd >= 0)
+            ::close(fd);
+        return false;
+    }
+    void *view = st.st_size > 0 ? mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    // the mapping keeps the file alive on its own
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cout << "ERROR::SPK::FILE_NOT_MAPPED: " << path << std::endl;
+        return false;
+    }
+    data = (const unsigned char *) view;
+    size = (size_t) st.st_size;
+#endif
+
+    // file record: id word, summary layout, first summary record and the binary format
+    if (size < DAF_RECORD_BYTES || std::memcmp(data, "DAF/SPK", 7) != 0) {
+        std::cout << "ERROR::SPK::NOT_AN_SPK_FILE: " << path << std::endl;
+        close();
+        return false;
+    }
+    bool little = host_is_little_endian();
+    if (std::memcmp(data + 88, "LTL-IEEE", 8) == 0)
+        swap_bytes = !little;
+    else if (std::memcmp(data + 88, "BIG-IEEE", 8) == 0)
+        swap_bytes = little;
+    else
+        swap_bytes = false;  // pre-N0035 kernels carry no format string and are native
+
+    int32_t nd = read_int(8), ni = read_int(12), forward = read_int(76);
+    if (nd != 2 || ni != 6) {
+        std::cout << "ERROR::SPK::UNSUPPORTED_SUMMARY_FORMAT: ND=" << nd << " NI=" << ni << std::endl;
+        close();
+        return false;
+    }
+
+    // walk the linked list of summary records; each holds up to 25 five-double summaries
+    const size_t summary_doubles = 2 + (6 + 1) / 2;
+    int32_t record = forward;
+    size_t visited = 0;
+    while (record > 0 && (size_t) record * DAF_RECORD_BYTES <= size && visited++ < size / DAF_RECORD_BYTES) {
+        uint64_t first = (uint64_t) (record - 1) * DAF_RECORD_BYTES / 8 + 1;
+        int32_t next = (int32_t) read_double(first);
+        int32_t count = (int32_t) read_double(first + 2);
+        for (int32_t k = 0; k < count && k < 25; k++) {
+            uint64_t summary = first + 3 + (uint64_t) k * summary_doubles;
+            uint64_t ints = (summary + 1) * 8;  // byte offset of the integer part
+            Segment segment;
+            segment.info.start_et = read_double(summary);
+            segment.info.end_et = read_double(summary + 1);
+            segment.info.target = read_int(ints);
+            segment.info.center = read_int(ints + 4);
+            segment.info.frame = read_int(ints + 8);
+            segment.info.type = read_int(ints + 12);
+            segment.begin = (uint32_t) read_int(ints + 16);
+            segment.end = (uint32_t) read_int(ints + 20);
+            if (segment.begin > 0 && segment.end >= segment.begin && (uint64_t) segment.end * 8 <= size)
+                segments.push_back(segment);
+        }
+        record = next;
+    }
+    return true;
+}
+
+void SpkKernel::close() {
+    if (data != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE) mapping_handle);
+        CloseHandle((HANDLE) file_handle);
+        mapping_handle = NULL;
+        file_handle = NULL;
+#else
+        munmap((void *) data, size);
+#endif
+    }
+    data = NULL;
+    size = 0;
+    segments.clear();
+    for (CacheEntry &entry: cache)
+        entry = CacheEntry();
+    cache_next = 0;
+}
+
+double SpkKernel::read_double(uint64_t address) const {
+    unsigned char bytes[8];
+    std::memcpy(bytes, data + (address - 1) * 8, 8);
+    if (swap_bytes)
+        for (int i = 0; i < 4; i++)
+            std::swap(bytes[i], bytes[7 - i]);
+    double value;
+    std::memcpy(&value, bytes, 8);
+    return value;
+}
+
+int32_t SpkKernel::read_int(uint64_t byte_offset) const {
+    unsigned char bytes[4];
+    std::memcpy(bytes, data + byte_offset, 4);
+    if (swap_bytes) {
+        std::swap(bytes[0], bytes[3]);
+        std::swap(bytes[1], bytes[2]);
+    }
+    int32_t value;
+    std::memcpy(&value, bytes, 4);
+    return value;
+}
+
+bool SpkKernel::decode(Segment &segment) const {
+    if (segment.decoded)
+        return true;
+    if (segment.info.type != 2 && segment.info.type != 3)
+        return false;
+    if (segment.end - segment.begin < 4)
+        return false;
+
+    // the directory at the end of the segment: INIT, INTLEN, RSIZE, N
+    segment.init = read_double(segment.end - 3);
+    segment.interval = read_double(segment.end - 2);
+    segment.record_size = (uint32_t) read_double(segment.end - 1);
+    segment.record_count = (uint32_t) read_double(segment.end);
+    uint32_t components = segment.info.type == 2 ? 3 : 6;
+    if (segment.interval <= 0.0 || segment.record_size < 2 + components || segment.record_count == 0
+        || (uint64_t) segment.record_size * segment.record_count > segment.end - segment.begin + 1)
+        return false;
+    segment.decoded = true;
+    return true;
+}
+
+const SpkKernel::Segment *SpkKernel::find_segment(int32_t target, double et) {
+    for (const CacheEntry &entry: cache) {
+        if (entry.target != target)
+            continue;
+        const Segment &segment = segments[entry.segment];
+        if (et >= segment.info.start_et && et <= segment.info.end_et) {
+            cache_hits++;
+            return &segment;
+        }
+    }
+    cache_misses++;
+
+    // later segments take precedence over earlier ones, as in SPICE
+    for (size_t i = segments.size(); i-- > 0;) {
+        Segment &segment = segments[i];
+        if (segment.info.target != target || et < segment.info.start_et || et > segment.info.end_et)
+            continue;
+        if (!decode(segment))
+            continue;
+        cache[cache_next].target = target;
+        cache[cache_next].segment = (uint32_t) i;
+        cache_next = (cache_next + 1) % CACHE_SIZE;
+        return &segment;
+    }
+    return NULL;
+}
+
+bool SpkKernel::state(int32_t target, double et, int32_t &center, glm::dvec3 &pos, glm::dvec3 *vel) {
+    const Segment *segment = data ? find_segment(target, et) : NULL;
+    if (segment == NULL)
+        return false;
+    center = segment->info.center;
+    evaluate(segment, et, pos, vel);
+    return true;
+}
+
+void SpkKernel::evaluate(const Segment *segment, double et, glm::dvec3 &pos, glm::dvec3 *vel) const {
+    uint32_t index = (uint32_t) std::max(0.0, std::floor((et - segment->init) / segment->interval));
+    index = std::min(index, segment->record_count - 1);
+    uint64_t record = segment->begin + (uint64_t) index * segment->record_size;
+
+    double mid = read_double(record), radius = read_double(record + 1);
+    double tau = (et - mid) / radius;
+    uint32_t components = segment->info.type == 2 ? 3 : 6;
+    uint32_t n = (segment->record_size - 2) / components;
+
+    // chebyshev series and, for velocities of type 2, its derivative, straight from the mapping
+    double p[6] = {0.0}, d[3] = {0.0};
+    for (uint32_t axis = 0; axis < components; axis++) {
+        uint64_t c = record + 2 + (uint64_t) axis * n;
+        double t_prev = 1.0, t_cur = tau, dt_prev = 0.0, dt_cur = 1.0;
+        double sum = read_double(c), derivative = 0.0;
+        for (uint32_t k = 1; k < n; k++) {
+            double coefficient = read_double(c + k);
+            sum += coefficient * t_cur;
+            derivative += coefficient * dt_cur;
+            double t_next = 2.0 * tau * t_cur - t_prev;
+            double dt_next = 2.0 * t_cur + 2.0 * tau * dt_cur - dt_prev;
+            t_prev = t_cur;
+            t_cur = t_next;
+            dt_prev = dt_cur;
+            dt_cur = dt_next;
+        }
+        p[axis] = sum;
+        if (axis < 3)
+            d[axis] = derivative / radius;
+    }
+
+    pos = glm::dvec3(p[0], p[1], p[2]);
+    if (vel)
+        *vel = segment->info.type == 3 ? glm::dvec3(p[3], p[4], p[5]) : glm::dvec3(d[0], d[1], d[2]);
+}
+
+bool SpkKernel::barycentric(int32_t body, double et, glm::dvec3 &pos) {
+    pos = glm::dvec3(0.0);
+    // bodies are at most a handful of hops from the barycenter; the limit guards against loops
+    for (int hop = 0; hop < 16 && body != NAIF_SOLAR_SYSTEM_BARYCENTER; hop++) {
+        const Segment *segment = data ? find_segment(body, et) : NULL;
+        if (segment == NULL)
+            return false;
+        glm::dvec3 offset;
+        evaluate(segment, et, offset, NULL);
+        pos += to_ecliptic(segment->info.frame, offset);
+        body = segment->info.center;
+    }
+    return body == NAIF_SOLAR_SYSTEM_BARYCENTER;
+}
+
+bool SpkKernel::position(int32_t target, int32_t observer, double et, glm::dvec3 &pos) {
+    glm::dvec3 target_pos, observer_pos;
+    if (!barycentric(target, et, target_pos) || !barycentric(observer, et, observer_pos))
+        return false;
+    pos = target_pos - observer_pos;
+    return true;
+}
@@ -0,0 +1,28 @@
+# writes OUTPUT, a C++ source holding every file of ASSETS (paths relative to SOURCE_DIR) as a
+# constexpr string, and the table embedded_assets.cpp looks them up in. run with cmake -P.
+set(declarations "")
+set(entries "")
+set(index 0)
+foreach (asset IN LISTS ASSETS)
+    file(READ ${SOURCE_DIR}/${asset} content)
+    string(FIND "${content}" ")asset\"" clash)
+    if (NOT clash EQUAL -1)
+        message(FATAL_ERROR "${asset} contains the raw string delimiter )asset\"")
+    endif ()
+    string(APPEND declarations "static constexpr char ASSET_${index}[] = R\"asset(${content})asset\";\n")
+    string(APPEND entries "    {\"${asset}\", ASSET_${index}, sizeof(ASSET_${index}) - 1, "
+            "embedded_asset_hash(ASSET_${index}, sizeof(ASSET_${index}) - 1)},\n")
+    math(EXPR index "${index} + 1")
+endforeach ()
+
+file(WRITE ${OUTPUT}.tmp "// generated by tools/embed_assets.cmake, do not edit\n"
+        "#include <embedded_assets.h>\n\n"
+        "${declarations}\n"
+        "static constexpr EmbeddedAsset ASSETS[] = {\n${entries}};\n\n"
+        "const EmbeddedAsset *embedded_assets(size_t &count) {\n"
+        "    count = sizeof(ASSETS) / sizeof(ASSETS[0]);\n"
+        "    return ASSETS;\n"
+        "}\n")
+# only touch the output when it changed, so the executables do not relink for nothing
+file(COPY_FILE ${OUTPUT}.tmp ${OUTPUT} ONLY_IF_DIFFERENT)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,124 @@
+#include <ephemeris.h>
+#include <solar_system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// the scene to sample, built afresh for every pass since the integrator only moves forward
+struct Scene {
+    BodyRegistry bodies;
+    NBodySystem nbody;
+    SimTick nbody_tick = 0;
+    std::vector<float> prev_x, prev_y, prev_z, next_x, next_y, next_z;  // states at nbody_tick - 1 h and nbody_tick
+};
+
+static EphemerisSampler build_scene(Scene &scene, size_t nbody_count) {
+    if (nbody_count > 0) {
+        build_nbody_system(scene.bodies, scene.nbody, nbody_count);
+        const size_t count = scene.nbody.size();
+        scene.next_x.resize(count);
+        scene.next_y.resize(count);
+        scene.next_z.resize(count);
+        scene.nbody.copy_positions(scene.next_x.data(), scene.next_y.data(), scene.next_z.data());
+        scene.prev_x = scene.next_x;
+        scene.prev_y = scene.next_y;
+        scene.prev_z = scene.next_z;
+        // the integrator takes whole hour steps and samples in between are interpolated, so a
+        // position does not depend on which ticks were asked for before it and both passes see
+        // the same trajectory. on these orbits the straight line is off by around 1e-6 units.
+        return [&scene](SimTick tick, float *x, float *y, float *z) {
+            while (scene.nbody_tick < tick) {
+                scene.prev_x.swap(scene.next_x);
+                scene.prev_y.swap(scene.next_y);
+                scene.prev_z.swap(scene.next_z);
+                scene.nbody.step((float) sim_days(SIM_TICKS_PER_HOUR));
+                scene.nbody.copy_positions(scene.next_x.data(), scene.next_y.data(), scene.next_z.data());
+                scene.nbody_tick += SIM_TICKS_PER_HOUR;
+            }
+            const float t = 1.0f - (float) (scene.nbody_tick - tick) / (float) SIM_TICKS_PER_HOUR;
+            for (size_t i = 0; i < scene.next_x.size(); i++) {
+                x[i] = scene.prev_x[i] + (scene.next_x[i] - scene.prev_x[i]) * t;
+                y[i] = scene.prev_y[i] + (scene.next_y[i] - scene.prev_y[i]) * t;
+                z[i] = scene.prev_z[i] + (scene.next_z[i] - scene.prev_z[i]) * t;
+            }
+        };
+    }
+    build_solar_system(scene.bodies);
+    return [&scene](SimTick tick, float *x, float *y, float *z) {
+        scene.bodies.seek(tick);
+        for (size_t i = 0; i < scene.bodies.size(); i++) {
+            glm::vec3 pos = scene.bodies.world_position((int32_t) i);
+            x[i] = pos.x;
+            y[i] = pos.y;
+            z[i] = pos.z;
+        }
+    };
+}
+
+// offline generator: fits chebyshev segments to the scene's body positions and writes the table.
+// segments start at --segment-days and are widened per body, up to --max-segment-days, as far as
+// its motion allows; a maximum no longer than the start keeps every body at the start length.
+//   ephemeris_gen <output> [--days D] [--segment-days S] [--max-segment-days M] [--coefficients N]
+//                 [--tolerance T] [--nbody COUNT]
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "usage: ephemeris_gen <output> [--days D] [--segment-days S] [--max-segment-days M]"
+                     " [--coefficients N] [--tolerance T] [--nbody COUNT]" << std::endl;
+        return -1;
+    }
+
+    std::string output = argv[1];
+    double days = 3650.0, max_segment_days = 256.0;
+    EphemerisFit fit;
+    size_t nbody_count = 0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--days")
+            days = std::atof(argv[i + 1]);
+        else if (arg == "--segment-days")
+            fit.segment_ticks = sim_ticks_from_days(std::atof(argv[i + 1]));
+        else if (arg == "--max-segment-days")
+            max_segment_days = std::atof(argv[i + 1]);
+        else if (arg == "--coefficients")
+            fit.max_coefficients = (uint32_t) std::atoi(argv[i + 1]);
+        else if (arg == "--tolerance")
+            fit.tolerance = (float) std::atof(argv[i + 1]);
+        else if (arg == "--nbody")
+            nbody_count = std::strtoul(argv[i + 1], NULL, 10);
+    }
+    const SimTick end_tick = sim_ticks_from_days(days);
+    const SimTick max_segment_ticks = std::min(sim_ticks_from_days(max_segment_days), end_tick);
+
+    // one pass over the span picks the segment lengths, a second one fits them
+    auto start = std::chrono::steady_clock::now();
+    Scene choice_scene;
+    EphemerisSampler choice_sample = build_scene(choice_scene, nbody_count);
+    const size_t body_count = choice_scene.bodies.size();
+    std::vector<EphemerisFit> fits(body_count, fit);
+    if (max_segment_ticks > fit.segment_ticks)
+        fits = EphemerisTable::choose_segments(choice_sample, body_count, 0, end_tick, max_segment_ticks, fits);
+    auto chosen = std::chrono::steady_clock::now();
+
+    Scene scene;
+    EphemerisSampler sample = build_scene(scene, nbody_count);
+    EphemerisTable table = EphemerisTable::fit(sample, body_count, 0, end_tick, fits);
+    auto end = std::chrono::steady_clock::now();
+    if (!table.save(output))
+        return -1;
+
+    SimTick shortest = table.segment_ticks(0), longest = shortest;
+    for (size_t b = 1; b < table.body_count(); b++) {
+        shortest = std::min(shortest, table.segment_ticks(b));
+        longest = std::max(longest, table.segment_ticks(b));
+    }
+    std::cout << "bodies: " << table.body_count() << ", days: " << days
+              << ", size: " << table.byte_size() / 1024.0 << " KiB, segments: " << sim_days(shortest) << " to "
+              << sim_days(longest) << " days, choosing segments: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(chosen - start).count() << " ms, fit: "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - chosen).count() << " ms" << std::endl;
+    return 0;
+}
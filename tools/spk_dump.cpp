@@ -0,0 +1,38 @@
+#include <spk.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+// lists the segments of an SPK kernel and optionally evaluates one body
+//   spk_dump <kernel.bsp> [target observer et_seconds]
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::cout << "usage: spk_dump <kernel.bsp> [target observer et_seconds]" << std::endl;
+        return -1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SpkKernel kernel;
+    if (!kernel.open(argv[1]))
+        return -1;
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "opened in " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()
+              << " us, " << kernel.segment_count() << " segments" << std::endl;
+
+    for (size_t i = 0; i < kernel.segment_count(); i++) {
+        SpkSegmentInfo info = kernel.segment_info(i);
+        std::cout << "  target " << info.target << " center " << info.center << " frame " << info.frame
+                  << " type " << info.type << " et [" << info.start_et << ", " << info.end_et << "]" << std::endl;
+    }
+
+    if (argc >= 5) {
+        glm::dvec3 pos;
+        if (!kernel.position(std::atoi(argv[2]), std::atoi(argv[3]), std::atof(argv[4]), pos)) {
+            std::cout << "no coverage for that body and time" << std::endl;
+            return -1;
+        }
+        std::cout << "position (km, ecliptic J2000): " << pos.x << " " << pos.y << " " << pos.z << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,305 @@
+#include <video_recorder.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define VIDEO_RECORDER_SSE2 1
+#endif
+
+// chroma from the sum of a 2x2 block: 128 + (c_r * R4 + c_g * G4 + c_b * B4) / 1024, rounded, with
+// the offset folded in so the shift only ever sees positive numbers
+static const int CHROMA_BIAS = 128 * 1024 + 512;
+
+VideoFormat video_format_from_path(const std::string &path) {
+    if (path == "-" || (path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0))
+        return VideoFormat::Y4M;
+    return VideoFormat::RawRGB;
+}
+
+static inline uint8_t luma(int r, int g, int b) {
+    return (uint8_t) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+}
+
+// one chroma sample from the 2x2 block at column pair 'cx' of rows 'r0' and 'r1'; a block hanging
+// over the right edge repeats the last column
+static inline void chroma(const uint8_t *r0, const uint8_t *r1, uint32_t cx, uint32_t width, uint32_t channels,
+                          uint8_t &u, uint8_t &v) {
+    uint32_t x0 = 2 * cx, x1 = std::min(x0 + 1, width - 1);
+    int r = r0[channels * x0] + r0[channels * x1] + r1[channels * x0] + r1[channels * x1];
+    int g = r0[channels * x0 + 1] + r0[channels * x1 + 1] + r1[channels * x0 + 1] + r1[channels * x1 + 1];
+    int b = r0[channels * x0 + 2] + r0[channels * x1 + 2] + r1[channels * x0 + 2] + r1[channels * x1 + 2];
+    u = (uint8_t) ((-38 * r - 74 * g + 112 * b + CHROMA_BIAS) >> 10);
+    v = (uint8_t) ((112 * r - 94 * g - 18 * b + CHROMA_BIAS) >> 10);
+}
+
+#ifdef VIDEO_RECORDER_SSE2
+// weighted sum of R, G and B for the two RGBA pixels held as 16-bit lanes, left in 32-bit lanes 0 and 2
+static inline __m128i weigh_pixels(__m128i rgba16, __m128i weights) {
+    __m128i pairs = _mm_madd_epi16(rgba16, weights);
+    return _mm_add_epi32(pairs, _mm_srli_epi64(pairs, 32));
+}
+
+// lanes 0 and 2 of 'a' and of 'b' gathered into one vector
+static inline __m128i gather_even(__m128i a, __m128i b) {
+    return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)),
+                              _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+// 16 RGBA pixels to 16 luma bytes
+static inline void luma16(const uint8_t *src, uint8_t *dst) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_setr_epi16(66, 129, 25, 0, 66, 129, 25, 0);
+    __m128i y[4];
+    for (int k = 0; k < 4; k++) {
+        __m128i px = _mm_loadu_si128((const __m128i *) (src + 16 * k));
+        __m128i lo = weigh_pixels(_mm_unpacklo_epi8(px, zero), weights);
+        __m128i hi = weigh_pixels(_mm_unpackhi_epi8(px, zero), weights);
+        y[k] = _mm_add_epi32(_mm_srli_epi32(_mm_add_epi32(gather_even(lo, hi), _mm_set1_epi32(128)), 8),
+                             _mm_set1_epi32(16));
+    }
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(y[0], y[1]), _mm_packs_epi32(y[2], y[3]));
+    _mm_storeu_si128((__m128i *) dst, packed);
+}
+
+// 8 RGBA pixels from each of two rows to 4 chroma samples each for u and v
+static inline void chroma4(const uint8_t *r0, const uint8_t *r1, uint8_t *u, uint8_t *v) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights_u = _mm_setr_epi16(-38, -74, 112, 0, -38, -74, 112, 0);
+    const __m128i weights_v = _mm_setr_epi16(112, -94, -18, 0, 112, -94, -18, 0);
+    const __m128i bias = _mm_set1_epi32(CHROMA_BIAS);
+
+    __m128i blocks[2];
+    for (int k = 0; k < 2; k++) {
+        __m128i top = _mm_loadu_si128((const __m128i *) (r0 + 16 * k));
+        __m128i bottom = _mm_loadu_si128((const __m128i *) (r1 + 16 * k));
+        // vertical sums of pixels 0-1 and 2-3, then each pair summed horizontally
+        __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+        __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+        lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+        hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+        blocks[k] = _mm_unpacklo_epi64(lo, hi);  // two 2x2 sums as R G B A R G B A
+    }
+    __m128i cu = gather_even(weigh_pixels(blocks[0], weights_u), weigh_pixels(blocks[1], weights_u));
+    __m128i cv = gather_even(weigh_pixels(blocks[0], weights_v), weigh_pixels(blocks[1], weights_v));
+    cu = _mm_srai_epi32(_mm_add_epi32(cu, bias), 10);
+    cv = _mm_srai_epi32(_mm_add_epi32(cv, bias), 10);
+    __m128i packed = _mm_packus_epi16(_mm_packs_epi32(cu, cv), zero);
+    uint32_t u4 = (uint32_t) _mm_cvtsi128_si32(packed);
+    uint32_t v4 = (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(packed, 4));
+    std::memcpy(u, &u4, 4);
+    std::memcpy(v, &v4, 4);
+}
+#endif
+
+void rgb_to_yuv420(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t channels, bool bottom_up,
+                   uint8_t *y, uint8_t *u, uint8_t *v) {
+    const size_t stride = (size_t) width * channels;
+    const uint32_t chroma_width = (width + 1) / 2;
+    auto row = [&](uint32_t top_down) {
+        return pixels + (size_t) (bottom_up ? height - 1 - top_down : top_down) * stride;
+    };
+
+    for (uint32_t line = 0; line < height; line += 2) {
+        // an odd last row pairs with itself
+        const uint8_t *r0 = row(line);
+        const uint8_t *r1 = row(std::min(line + 1, height - 1));
+        for (uint32_t pass = 0; pass < 2 && line + pass < height; pass++) {
+            const uint8_t *src = pass ? r1 : r0;
+            uint8_t *dst = y + (size_t) (line + pass) * width;
+            uint32_t x = 0;
+#ifdef VIDEO_RECORDER_SSE2
+            if (channels == 4)
+                for (; x + 16 <= width; x += 16)
+                    luma16(src + 4 * x, dst + x);
+#endif
+            for (; x < width; x++)
+                dst[x] = luma(src[channels * x], src[channels * x + 1], src[channels * x + 2]);
+        }
+
+        uint8_t *du = u + (size_t) (line / 2) * chroma_width;
+        uint8_t *dv = v + (size_t) (line / 2) * chroma_width;
+        uint32_t cx = 0;
+#ifdef VIDEO_RECORDER_SSE2
+        if (channels == 4)
+            for (; 2 * cx + 8 <= width; cx += 4)
+                chroma4(r0 + 8 * cx, r1 + 8 * cx, du + cx, dv + cx);
+#endif
+        for (; cx < chroma_width; cx++)
+            chroma(r0, r1, cx, width, channels, du[cx], dv[cx]);
+    }
+}
+
+VideoRecorder::~VideoRecorder() {
+    close();
+}
+
+bool VideoRecorder::open(const std::string &path, VideoFormat format, uint32_t width, uint32_t height,
+                         double frames_per_second, size_t ring_frames, bool drop_when_full) {
+    close();
+    if (path == "-") {
+        output = stdout;
+        owns_output = false;
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    } else {
+        output = std::fopen(path.c_str(), "wb");
+        owns_output = true;
+        if (output == NULL) {
+            std::cout << "ERROR::VIDEO::FILE_NOT_WRITABLE: " << path << std::endl;
+            return false;
+        }
+    }
+
+    this->format = format;
+    this->width = width;
+    this->height = height;
+    this->drop_when_full = drop_when_full;
+    counters = VideoRecorderStats();
+
+    if (format == VideoFormat::Y4M) {
+        // frame rate as a ratio, exact for whole rates and for the NTSC style 1000/1001 ones
+        uint64_t num = (uint64_t) std::llround(frames_per_second * 1001.0), den = 1001;
+        uint64_t common = std::gcd(num, den);
+        std::string header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height)
+                             + " F" + std::to_string(num / common) + ":" + std::to_string(den / common)
+                             + " Ip A1:1 C420jpeg\n";
+        std::fwrite(header.data(), 1, header.size(), output);
+        counters.bytes_written += header.size();
+    }
+
+    ring.assign(std::max<size_t>(ring_frames, 1), Frame());
+    for (Frame &frame: ring)
+        frame.pixels.reserve((size_t) width * height * 4);
+    head = 0;
+    queued = 0;
+    stopping = false;
+    encoder = std::thread(&VideoRecorder::encoder_loop, this);
+    return true;
+}
+
+void VideoRecorder::close() {
+    if (output == NULL)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    filled.notify_one();
+    emptied.notify_all();
+    encoder.join();
+
+    std::fflush(output);
+    if (owns_output)
+        std::fclose(output);
+    output = NULL;
+    ring.clear();
+    planes.clear();
+}
+
+bool VideoRecorder::push_frame(const uint8_t *pixels, uint32_t frame_width, uint32_t frame_height,
+                               uint32_t channels, bool bottom_up) {
+    if (output == NULL)
+        return false;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (frame_width != width || frame_height != height || (channels != 3 && channels != 4)) {
+        counters.frames_dropped++;
+        return false;
+    }
+    if (queued == ring.size()) {
+        if (drop_when_full) {
+            counters.frames_dropped++;
+            return false;
+        }
+        counters.stalls++;
+        emptied.wait(lock, [this] { return queued < ring.size() || stopping; });
+        if (stopping)
+            return false;
+    }
+
+    // the encoder does not look at a slot until it is counted as queued, so it is filled unlocked
+    Frame &frame = ring[(head + queued) % ring.size()];
+    lock.unlock();
+    frame.pixels.assign(pixels, pixels + (size_t) width * height * channels);
+    frame.channels = channels;
+    frame.bottom_up = bottom_up;
+    lock.lock();
+    queued++;
+    lock.unlock();
+    filled.notify_one();
+    return true;
+}
+
+void VideoRecorder::drop_frame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    counters.frames_dropped++;
+}
+
+VideoRecorderStats VideoRecorder::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void VideoRecorder::encoder_loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    bool failed = false;
+    while (true) {
+        filled.wait(lock, [this] { return stopping || queued > 0; });
+        if (queued == 0)
+            break;  // stopping with nothing left to write
+        const Frame &frame = ring[head];
+        lock.unlock();
+
+        bool written = !failed && write_frame(frame);
+        if (!written && !failed) {
+            std::cout << "ERROR::VIDEO::WRITE_FAILED, dropping the rest of the recording" << std::endl;
+            failed = true;
+        }
+
+        lock.lock();
+        head = (head + 1) % ring.size();
+        queued--;
+        if (written) {
+            counters.frames_written++;
+            counters.bytes_written += planes.size() + (format == VideoFormat::Y4M ? 6 : 0);
+        } else {
+            counters.frames_dropped++;
+        }
+        emptied.notify_one();
+    }
+}
+
+bool VideoRecorder::write_frame(const Frame &frame) {
+    const size_t luma_bytes = (size_t) width * height;
+    if (format == VideoFormat::Y4M) {
+        const size_t chroma_bytes = (size_t) ((width + 1) / 2) * ((height + 1) / 2);
+        planes.resize(luma_bytes + 2 * chroma_bytes);
+        rgb_to_yuv420(frame.pixels.data(), width, height, frame.channels, frame.bottom_up,
+                      planes.data(), planes.data() + luma_bytes, planes.data() + luma_bytes + chroma_bytes);
+        if (std::fwrite("FRAME\n", 1, 6, output) != 6)
+            return false;
+    } else {
+        planes.resize(luma_bytes * 3);
+        const size_t stride = (size_t) width * frame.channels;
+        for (uint32_t y = 0; y < height; y++) {
+            const uint8_t *src = frame.pixels.data() + (frame.bottom_up ? height - 1 - y : y) * stride;
+            uint8_t *dst = planes.data() + (size_t) y * width * 3;
+            for (uint32_t x = 0; x < width; x++) {
+                dst[3 * x] = src[frame.channels * x];
+                dst[3 * x + 1] = src[frame.channels * x + 1];
+                dst[3 * x + 2] = src[frame.channels * x + 2];
+            }
+        }
+    }
+    return std::fwrite(planes.data(), 1, planes.size(), output) == planes.size();
+}